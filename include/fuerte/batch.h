@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#ifndef ARANGO_CXX_DRIVER_BATCH
+#define ARANGO_CXX_DRIVER_BATCH
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+#include "message.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 {
+
+class Connection;
+
+// Batch packs requests into one multipart request to /_api/batch
+// (see Database::createBatch), so HTTP connections send many operations in
+// one round trip. Every request becomes a part that runs in the database of
+// the batch. The multipart response is split into one Response per part and
+// handed to the callback of its request. JSON bodies of parts are converted
+// to velocypack, so slices() works as usual.
+// When the batch request fails, every callback gets the error. When the
+// server rejects the batch as a whole, every callback gets its response.
+// Requests with a body source cannot be part of a batch.
+class Batch {
+  friend class Database;
+
+  public:
+    // Prevent copying
+    Batch(Batch const& other) = delete;
+    Batch& operator=(Batch const& other) = delete;
+
+    // add queues a request.
+    // Throws std::invalid_argument for requests with a body source.
+    void add(std::unique_ptr<Request> request, RequestCallback cb);
+    // size returns the number of queued requests.
+    std::size_t size();
+    // send sends the queued requests and returns immediately.
+    // The batch is empty afterwards and can be filled again.
+    void send();
+
+  private:
+    Batch(std::shared_ptr<Connection> conn, std::string const& database);
+
+  private:
+    std::shared_ptr<Connection> _conn;
+    std::string _database;
+    std::string _boundary;
+
+    std::mutex _mutex;
+    std::vector<std::pair<std::unique_ptr<Request>, RequestCallback>> _parts;
+};
+
+}}}
+#endif
@@ -23,30 +23,125 @@
 #ifndef ARANGO_CXX_DRIVER_COLLECTION
 #define ARANGO_CXX_DRIVER_COLLECTION
 
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include "types.h"
 
 namespace arangodb { namespace fuerte { inline namespace v1 {
 
 class Database;
+class Importer;
+struct ImportOptions;
+
+namespace impl {
+  class DocumentBatcher;
+  class DocumentCache;
+}
+
+// DocumentCallback receives the result of a single document operation.
+// On success error is 0 and result is the object the server returned for
+// the document (which carries "error" and "errorNum" when the server
+// rejected it). result is only valid while the callback runs.
+using DocumentCallback = std::function<void(Error error, VSlice result)>;
+
+// BatchOptions control how single document operations are combined into
+// array requests (see Collection::batching).
+struct BatchOptions {
+  BatchOptions()
+    : maxDocuments(1)
+    , maxBytes(1024 * 1024)
+    , linger(0)
+    , combineUpdates(false)
+    {}
+
+  std::size_t maxDocuments;         // send when this many documents are pending
+  std::size_t maxBytes;             // send when the pending documents are this large
+  std::chrono::microseconds linger; // send when the oldest document waited this long
+  bool combineUpdates;              // merge pending updates of the same _key into one
+};
+
+// CacheOptions control the document cache of a collection (see
+// Collection::caching).
+struct CacheOptions {
+  CacheOptions()
+    : maxBytes(0)
+    {}
+
+  std::size_t maxBytes; // budget for the keys & documents, 0 = no cache
+};
 
 class Collection : public std::enable_shared_from_this<Collection> {
     friend class Database;
-    typedef std::string Document; //FIXME
 
   public:
-    bool insert(Document){ return false; }
-    void drop(Document){}
-    void update(Document, Document){}
-    void replace(Document, Document){}
-    void dropAll(){}
-    void find(Document){}
+    ~Collection();
+
+    // batching sets how the following insert, update, replace and drop calls
+    // are combined into array requests to /_api/document/<collection>.
+    // The default sends every document on its own.
+    // With combineUpdates an update of a _key that is still pending is merged
+    // into the pending patch (later attributes win) and all its callers get
+    // the result of the one write.
+    // Pending documents of one kind are sent before a write of another kind
+    // is queued, so the requests go out in the order of the calls. A
+    // connection that runs requests concurrently (several HTTP connections,
+    // VST, HTTP/2) may still apply them out of order, wait for the callback
+    // when a later write depends on an earlier one.
+    void batching(BatchOptions const& options);
+    // lookups sets how find calls are combined into multi-document lookups
+    // (PUT /_api/document/<collection>?onlyget=true). A key that is asked
+    // for again while its lookup is pending shares the result.
+    // By default every find fetches its document on its own.
+    void lookups(BatchOptions const& options);
+    // caching keeps documents read by find and written through this
+    // collection in memory, so find answers them without a request.
+    // Only changes made through this collection are noticed, documents
+    // changed by others are served until they are evicted.
+    void caching(CacheOptions const& options);
+    // flush sends all pending documents and lookups now.
+    void flush();
+
+    // insert stores a new document.
+    void insert(VSlice const& document, DocumentCallback cb);
+    // update merges the given attributes into the document with the same _key.
+    void update(VSlice const& document, DocumentCallback cb);
+    // replace replaces the document with the same _key.
+    void replace(VSlice const& document, DocumentCallback cb);
+    // drop removes a document, given as key string or as object with _key.
+    void drop(VSlice const& document, DocumentCallback cb);
+    // dropAll removes all documents of the collection.
+    void dropAll(DocumentCallback cb);
+    // find fetches the document with the given key. A cached document is
+    // passed to the callback before find returns.
+    void find(std::string const& key, DocumentCallback cb);
+
+    // importer returns an Importer that loads documents into this
+    // collection through /_api/import.
+    std::shared_ptr<Importer> importer(ImportOptions const& options);
+    std::shared_ptr<Importer> importer();
+
+    std::string const& name() const { return _name; }
 
   private:
     Collection(std::shared_ptr<Database>, std::string name);
+    // ordered sends the pending documents of the batcher that was written to
+    // before when it is not the given one and returns the given one.
+    impl::DocumentBatcher& ordered(std::shared_ptr<impl::DocumentBatcher> const& batcher);
+
     std::shared_ptr<Database> _db;
     std::string _name;
+    BatchOptions _batchOptions;
+    std::shared_ptr<impl::DocumentBatcher> _inserts;
+    std::shared_ptr<impl::DocumentBatcher> _updates;
+    std::shared_ptr<impl::DocumentBatcher> _replaces;
+    std::shared_ptr<impl::DocumentBatcher> _drops;
+    std::shared_ptr<impl::DocumentBatcher> _lookups; // nullptr = not batched
+    std::mutex _writeMutex;
+    std::shared_ptr<impl::DocumentBatcher> _lastWrite; // batcher of the last write
+    std::shared_ptr<impl::DocumentCache> _cache;     // nullptr = not cached
 
 };
 
@@ -33,11 +33,18 @@
 
 namespace arangodb { namespace fuerte { inline namespace v1 {
 
+class Database;
+
+namespace impl {
+  class BatchTimer;
+}
+
 // Connection is the base class for a connection between a client
 // and a server.
 // Different protocols (HTTP, VST) are implemented in derived classes.
 class Connection : public std::enable_shared_from_this<Connection> {
   friend class ConnectionBuilder;
+  friend class impl::BatchTimer;
 
   public:
     virtual ~Connection();
@@ -65,6 +72,9 @@ class Connection : public std::enable_shared_from_this<Connection> {
     // Return the number of requests that have not yet finished.
     virtual std::size_t requestsLeft() = 0;
 
+    // Return a handle for the database with the given name.
+    std::shared_ptr<Database> getDatabase(std::string const& name);
+
   private:
     // Activate the connection.  
     virtual void start() {}
@@ -120,6 +130,50 @@ class ConnectionBuilder {
     // Set the VST version to use (VST only)
     inline vst::VSTVersion vstVersion() const { return _conf._vstVersion; }
     ConnectionBuilder& vstVersion(vst::VSTVersion c){ _conf._vstVersion = c; return *this; }
+    // Set how received messages are validated (VST only)
+    inline vst::ValidationLevel vstValidation() const { return _conf._vstValidation; }
+    ConnectionBuilder& vstValidation(vst::ValidationLevel l){ _conf._vstValidation = l; return *this; }
+    // Set that every n-th message is fully validated with ValidateSampled (VST only)
+    inline std::size_t vstValidationSampleRate() const { return _conf._vstValidationSampleRate; }
+    ConnectionBuilder& vstValidationSampleRate(std::size_t n){ _conf._vstValidationSampleRate = n; return *this; }
+    // Set the HTTP version to use (HTTP only)
+    inline http::HTTPVersion httpVersion() const { return _conf._httpVersion; }
+    ConnectionBuilder& httpVersion(http::HTTPVersion v){ _conf._httpVersion = v; return *this; }
+    // Set the maximum number of concurrent streams on a single HTTP/2 connection (HTTP only)
+    inline std::size_t maxConcurrentStreams() const { return _conf._maxConcurrentStreams; }
+    ConnectionBuilder& maxConcurrentStreams(std::size_t c){ _conf._maxConcurrentStreams = c; return *this; }
+    // Set the maximum number of sockets that are opened to the host (HTTP only)
+    inline std::size_t maxHostConnections() const { return _conf._maxHostConnections; }
+    ConnectionBuilder& maxHostConnections(std::size_t c){ _conf._maxHostConnections = c; return *this; }
+    // Set the implementation used for HTTP connections (HTTP only)
+    inline http::HTTPBackend httpBackend() const { return _conf._httpBackend; }
+    ConnectionBuilder& httpBackend(http::HTTPBackend b){ _conf._httpBackend = b; return *this; }
+    // Write requests without waiting for the previous response (HTTP AsioBackend only)
+    inline bool httpPipelining() const { return _conf._httpPipelining; }
+    ConnectionBuilder& httpPipelining(bool p){ _conf._httpPipelining = p; return *this; }
+    // Share the DNS cache and TLS sessions with all other
+    // HTTP connections of the EventLoopService that do so (HTTP CurlBackend only)
+    inline bool shareHttpCaches() const { return _conf._shareHttpCaches; }
+    ConnectionBuilder& shareHttpCaches(bool s){ _conf._shareHttpCaches = s; return *this; }
+    // Write response payloads larger than the given number of bytes to a
+    // temporary file that is mapped into memory (0 = never)
+    inline std::size_t responseSpillThreshold() const { return _conf._responseSpillThreshold; }
+    ConnectionBuilder& responseSpillThreshold(std::size_t t){ _conf._responseSpillThreshold = t; return *this; }
+    // Set the directory for the temporary files of large responses
+    inline std::string responseSpillDirectory() const { return _conf._responseSpillDirectory; }
+    ConnectionBuilder& responseSpillDirectory(std::string const& d){ _conf._responseSpillDirectory = d; return *this; }
+    // Let identical GET & HEAD requests that are sent while one of them is
+    // in flight share its response instead of sending them again
+    inline bool singleFlight() const { return _conf._singleFlight; }
+    ConnectionBuilder& singleFlight(bool s){ _conf._singleFlight = s; return *this; }
+    // Keep the responses of up to the given number of GET requests and
+    // answer identical requests from them (0 = no response cache)
+    inline std::size_t responseCacheSize() const { return _conf._responseCacheSize; }
+    ConnectionBuilder& responseCacheSize(std::size_t s){ _conf._responseCacheSize = s; return *this; }
+    // Set how long cached responses are used without asking the server,
+    // older ones are revalidated with their ETag
+    inline std::chrono::milliseconds responseCacheTTL() const { return _conf._responseCacheTTL; }
+    ConnectionBuilder& responseCacheTTL(std::chrono::milliseconds t){ _conf._responseCacheTTL = t; return *this; }
     // Set a callback for connection failures that are not request specific.
     ConnectionBuilder& onFailure(ConnectionFailureCallback c){ _conf._onFailure = c; return *this; }
 
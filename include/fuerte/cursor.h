@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#ifndef ARANGO_CXX_DRIVER_CURSOR
+#define ARANGO_CXX_DRIVER_CURSOR
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "types.h"
+#include "message.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 {
+
+class Connection;
+
+// Cursor runs an AQL query and fetches its result batch by batch
+// (see Database::createCursor).
+// The next batch is requested as soon as a batch arrives, until `prefetch`
+// batches are waiting to be consumed, so the consumer rarely has to wait
+// for a round trip. Batches are requested one after the other, the server
+// does not allow concurrent access to a cursor.
+// When the Cursor is destroyed before all batches have been fetched, the
+// cursor is deleted on the server.
+class Cursor : public std::enable_shared_from_this<Cursor> {
+  friend class Database;
+
+  public:
+    ~Cursor();
+
+    // Prevent copying
+    Cursor(Cursor const& other) = delete;
+    Cursor& operator=(Cursor const& other) = delete;
+
+    // next waits for the next batch and returns its response. The documents
+    // of the batch are in the "result" array of response->slices().front().
+    // Returns nullptr when all batches have been consumed.
+    // Throws the ErrorCondition of a failed request, or std::runtime_error
+    // when the server rejected the query.
+    std::unique_ptr<Response> next();
+
+    // available returns the number of batches that can be taken from next
+    // without waiting.
+    std::size_t available();
+
+    // id returns the id of the server side cursor (empty when the result
+    // fits into the first batch or the first batch has not arrived yet).
+    std::string id();
+
+  private:
+    Cursor(std::shared_ptr<Connection> conn, std::string const& database,
+           std::size_t prefetch);
+
+    // start sends the request that creates the cursor.
+    void start(std::unique_ptr<Request> request);
+    // nextRequest returns the request for the next batch, or nullptr when
+    // no batch should be requested now. Must be called with _mutex held.
+    std::unique_ptr<Request> nextRequest(bool force);
+    // send sends a request for a batch.
+    void send(std::unique_ptr<Request> request);
+    // received handles the response (or error) of a batch request.
+    void received(Error error, std::unique_ptr<Response> response);
+
+  private:
+    std::shared_ptr<Connection> _conn;
+    std::string _database;
+    std::size_t _prefetch;
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::deque<std::unique_ptr<Response>> _batches; // received, not yet consumed
+    std::string _id;
+    bool _fetching;        // a batch request is in flight
+    bool _hasMore;         // the server has more batches
+    Error _error;          // error of the last batch request
+    std::string _errorMessage; // error reported by the server
+};
+
+}}}
+#endif
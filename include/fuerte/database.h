@@ -23,26 +23,88 @@
 #ifndef ARANGO_CXX_DRIVER_DATABASE
 #define ARANGO_CXX_DRIVER_DATABASE
 
+#include <chrono>
 #include <memory>
 #include <string>
+#include <vector>
+
+#include "types.h"
 
 namespace arangodb { namespace fuerte { inline namespace v1 {
 
+class Batch;
 class Connection;
 class Collection;
+class Cursor;
+class Transaction;
+struct TransactionOptions;
+
+namespace impl {
+  class QueryCache;
+}
+
+// QueryCacheOptions control the query result cache of a database (see
+// Database::queryCaching).
+struct QueryCacheOptions {
+  QueryCacheOptions()
+    : maxBytes(0)
+    , ttl(60000)
+    {}
+
+  std::size_t maxBytes;          // budget for the cached results, 0 = no cache
+  std::chrono::milliseconds ttl; // results are used for this long
+};
 
 class Database : public std::enable_shared_from_this<Database> {
   friend class Connection;
+  friend class Collection;
 
   public:
     std::shared_ptr<Collection> getCollection(std::string const& name);
     std::shared_ptr<Collection> createCollection(std::string const& name);
     bool deleteCollection(std::string const& name);
 
+    // createCursor runs the given AQL query and returns a cursor on its
+    // result (see Cursor). batchSize 0 uses the server default, up to
+    // prefetch batches are fetched ahead of the consumer.
+    std::shared_ptr<Cursor> createCursor(std::string const& query,
+                                         VSlice const& bindVars = VSlice(),
+                                         std::size_t batchSize = 0,
+                                         std::size_t prefetch = 1);
+
+    // createBatch returns a Batch that sends requests to this database as
+    // one /_api/batch request.
+    std::shared_ptr<Batch> createBatch();
+
+    // beginTransaction starts a stream transaction and returns immediately,
+    // operations on the transaction are sent once it was started
+    // (see Transaction).
+    std::shared_ptr<Transaction> beginTransaction(TransactionOptions const& options);
+
+    // queryCaching keeps the results of query in memory, so repeating a
+    // query with the same bind parameters does not ask the server.
+    void queryCaching(QueryCacheOptions const& options);
+    // query runs the given AQL query and returns the velocypack array of all
+    // its results. The buffer is shared with the cache and must not be
+    // changed. collections names the collections the query reads, writes
+    // through Collection objects of this database and invalidateQueries drop
+    // the cached results that depend on them.
+    // Throws like Cursor::next.
+    std::shared_ptr<VBuffer const> query(std::string const& query,
+                                         VSlice const& bindVars = VSlice(),
+                                         std::vector<std::string> const& collections = std::vector<std::string>());
+    // invalidateQueries drops the cached results of queries that read the
+    // given collection.
+    void invalidateQueries(std::string const& collection);
+
+    std::shared_ptr<Connection> const& connection() const { return _conn; }
+    std::string const& name() const { return _name; }
+
   private:
     Database(std::shared_ptr<Connection>, std::string const& name);
     std::shared_ptr<Connection> _conn;
     std::string _name;
+    std::shared_ptr<impl::QueryCache> _queryCache; // nullptr = not cached
 };
 
 }}}
@@ -23,9 +23,13 @@
 #ifndef ARANGO_CXX_DRIVER_ARANGOC
 #define ARANGO_CXX_DRIVER_ARANGOC
 
+#include "batch.h"
 #include "connection.h"
 #include "database.h"
 #include "collection.h"
+#include "cursor.h"
+#include "importer.h"
+#include "transaction.h"
 #include "requests.h"
 #include "helper.h"
 #include "waitgroup.h"
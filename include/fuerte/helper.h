@@ -84,6 +84,13 @@ std::string to_string(VSlice const& slice);
 std::string to_string(std::vector<VSlice> const& payload);
 std::string to_string(Message& message);
 StringMap sliceToStringMap(VSlice const&);
+HeaderMap sliceToHeaderMap(VSlice const&);
+// copyResponse creates a response with the header & payload of the given one.
+std::unique_ptr<Response> copyResponse(Response const& response);
+// requestIdentity returns a key that is equal for requests that yield the same
+// response (verb, database, path, parameters, meta & credentials). Only GET
+// & HEAD requests without body have one, the key of others is empty.
+std::string requestIdentity(Request const& request);
 
 template<typename K, typename V, typename A>
 std::string mapToString(std::map<K,V,A> map){
@@ -109,10 +116,15 @@ namespace http {
   std::string urlDecode(std::string const& str);
   std::string urlEncode(char const* src, size_t const len);
   std::string urlEncode(char const* src);
+  // appends the url encoded form of src to out.
+  void urlEncode(std::string& out, char const* src, size_t const len);
 
   inline std::string urlEncode(std::string const& str) {
     return urlEncode(str.c_str(), str.size());
   }
+  inline void urlEncode(std::string& out, std::string const& str) {
+    urlEncode(out, str.c_str(), str.size());
+  }
 }
 
 }}}
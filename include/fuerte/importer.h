@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#ifndef ARANGO_CXX_DRIVER_IMPORTER
+#define ARANGO_CXX_DRIVER_IMPORTER
+
+#include <condition_variable>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "message.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 {
+
+class Connection;
+
+// ImportOptions control how an Importer sends documents.
+struct ImportOptions {
+  ImportOptions()
+    : batchBytes(4 * 1024 * 1024)
+    , maxInFlight(4)
+    {}
+
+  std::size_t batchBytes;   // send a batch when it is this large
+  std::size_t maxInFlight;  // batches that are sent but not answered, per connection
+  // Connections that share the load (empty = the connection of the collection).
+  std::vector<std::shared_ptr<Connection>> connections;
+};
+
+// ImportResult sums up the results of all batches of an import.
+struct ImportResult {
+  ImportResult()
+    : created(0), errors(0), empty(0), updated(0), ignored(0), failed(0), error(0)
+    {}
+
+  std::size_t created;
+  std::size_t errors;   // documents the server rejected
+  std::size_t empty;
+  std::size_t updated;
+  std::size_t ignored;
+  std::size_t failed;   // documents of batches that could not be sent
+  Error error;          // first error of a batch that could not be sent
+  std::string errorMessage; // first error of a batch the server rejected
+};
+
+// Importer loads documents into a collection through /_api/import
+// (see Collection::importer).
+// Documents are cut into batches of about ImportOptions::batchBytes. The
+// batches are spread over all connections, add blocks while every
+// connection has maxInFlight unanswered batches.
+// Batches are not resent when a connection fails.
+// Documents must be added from one thread.
+class Importer {
+  friend class Collection;
+
+  public:
+    // Waits for all batches.
+    ~Importer();
+
+    // Prevent copying
+    Importer(Importer const& other) = delete;
+    Importer& operator=(Importer const& other) = delete;
+
+    // add queues a document.
+    void add(VSlice const& document);
+    // addJson queues a document given as JSON text (without line breaks).
+    void addJson(std::string const& json);
+    // addJsonLines queues all documents of a stream with one JSON document
+    // per line (JSONL). Empty lines are skipped.
+    void addJsonLines(std::istream& in);
+
+    // finish sends the last batches, waits until all batches have been
+    // answered and returns the summed up result.
+    ImportResult finish();
+
+  private:
+    Importer(std::string const& database, std::string const& collection,
+             ImportOptions const& options);
+
+    // sendDocuments / sendJson send the pending batch of that format.
+    void sendDocuments();
+    void sendJson();
+    // send sends a batch on the least busy connection.
+    void send(std::unique_ptr<Request> request, std::size_t documents);
+    // received adds the result of a batch.
+    void received(std::size_t connection, std::size_t documents, Error error,
+                  std::unique_ptr<Response> response);
+
+  private:
+    std::string _database;
+    std::string _collection;
+    ImportOptions _options;
+
+    std::unique_ptr<VBuilder> _documents; // pending VPack documents
+    std::size_t _documentCount;
+    std::size_t _documentBytes;           // size of the pending VPack documents
+    VBuffer _json;                        // pending JSONL documents
+    std::size_t _jsonCount;
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::vector<std::size_t> _inFlight;   // per connection
+    std::size_t _totalInFlight;
+    ImportResult _result;
+};
+
+}}}
+#endif
@@ -27,6 +27,7 @@
 
 #include <utility>
 #include <memory>
+#include <mutex>
 #include <iostream>
 
 #include <boost/asio.hpp>
@@ -43,9 +44,12 @@ namespace vst {
 
 namespace http {
   class HttpConnection;
+  class HttpAsioConnection;
+  class CurlShare;
 }
 
 namespace impl {
+  class BatchTimer;
   class VpackInit;
 }
 
@@ -82,6 +86,8 @@ class GlobalService {
 class EventLoopService {
   friend class vst::VstConnection;
   friend class http::HttpConnection;
+  friend class http::HttpAsioConnection;
+  friend class impl::BatchTimer;
 
  public:
   // Initialize an EventLoopService with a given number of threads and a new io_service.
@@ -125,11 +131,17 @@ class EventLoopService {
   // io_service returns a reference to the boost io_service.
   std::shared_ptr<asio_io_service>& io_service() { return io_service_; }
 
+  // curlShare returns the curl share (DNS, TLS sessions) used by
+  // all HTTP connections of this service that opted in. Created on first use.
+  std::shared_ptr<http::CurlShare> curlShare();
+
  private:
   GlobalService& global_service_;
   std::shared_ptr<asio_io_service> io_service_;
   std::unique_ptr<asio_work> working_;  // Used to keep the io-service alive.
   boost::thread_group threadGroup_;     // Used to join on.
+  std::mutex curl_share_mutex_;
+  std::shared_ptr<http::CurlShare> curl_share_;
 };
 
 }}}
@@ -25,7 +25,9 @@
 #define ARANGO_CXX_DRIVER_MESSAGE
 
 #include <chrono>
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -33,17 +35,139 @@
 
 #include <boost/optional.hpp>
 #include <boost/asio/buffer.hpp>
+#include <boost/utility/string_ref.hpp>
 
 namespace arangodb { namespace fuerte { inline namespace v1 {
 
 const std::string fu_content_type_key("content-type");
 const std::string fu_accept_key("accept");
 
+// HeaderKey identifies the header keys fuerte looks at itself.
+enum class HeaderKey : uint8_t {
+  Other = 0,
+  ContentType,
+  Accept,
+  ContentLength,
+  Authorization,
+  Connection,
+  TransferEncoding
+};
+
+// HeaderMap is a flat map of header fields. The strings of all fields are kept
+// in one buffer, so filling the map takes a couple of allocations instead of
+// several per field. Keys are case insensitive and stored in lower case.
+// Well known keys are recognized when they are inserted, the content type and
+// accept type are parsed once and cached.
+// The fields can also be assigned from a velocypack object that is only
+// decoded when the map is accessed for the first time (see assignLazy).
+class HeaderMap {
+  struct Field {
+    uint32_t key;
+    uint32_t keyLength;
+    uint32_t value;
+    uint32_t valueLength;
+    HeaderKey id;
+  };
+
+ public:
+  typedef std::pair<boost::string_ref, boost::string_ref> value_type;
+
+  class const_iterator {
+   public:
+    const_iterator(HeaderMap const* map, std::size_t pos) : _map(map), _pos(pos) {}
+    value_type operator*() const { return _map->at(_pos); }
+    const_iterator& operator++() { ++_pos; return *this; }
+    bool operator==(const_iterator const& other) const { return _pos == other._pos; }
+    bool operator!=(const_iterator const& other) const { return _pos != other._pos; }
+   private:
+    HeaderMap const* _map;
+    std::size_t _pos;
+  };
+
+  HeaderMap()
+      : _contentType(ContentType::Unset), _acceptType(ContentType::Unset), _lazy(nullptr) {}
+  // allows assignment from a StringMap
+  HeaderMap(StringMap const& map);
+  // copies & moves decode lazily assigned fields first, so a lazy map never
+  // outlives the buffer it points into by accident.
+  HeaderMap(HeaderMap const& other);
+  HeaderMap(HeaderMap&& other);
+  HeaderMap& operator=(HeaderMap const& other);
+  HeaderMap& operator=(HeaderMap&& other);
+
+  inline bool empty() const { decode(); return _fields.empty(); }
+  inline std::size_t size() const { decode(); return _fields.size(); }
+  void clear();
+  // reserve room for the given number of fields and bytes of keys & values.
+  void reserve(std::size_t fields, std::size_t bytes);
+
+  // set the value of the given key, replacing an existing value.
+  void set(boost::string_ref key, boost::string_ref value);
+  // add the given key & value unless the key exists already.
+  // Returns false when the key existed.
+  bool emplace(boost::string_ref key, boost::string_ref value);
+
+  // contains returns true when a field with the given key exists.
+  bool contains(boost::string_ref key) const;
+  bool contains(HeaderKey key) const;
+  // value returns the value of the given key, or an empty string if not found.
+  boost::string_ref value(boost::string_ref key) const;
+  boost::string_ref value(HeaderKey key) const;
+
+  // cached, parsed values of the content-type & accept fields
+  inline ContentType contentType() const { decode(); return _contentType; }
+  inline ContentType acceptType() const { decode(); return _acceptType; }
+
+  value_type at(std::size_t pos) const;
+  const_iterator begin() const { decode(); return const_iterator(this, 0); }
+  const_iterator end() const { decode(); return const_iterator(this, _fields.size()); }
+
+  StringMap toStringMap() const;
+
+  // read accessors of the former boost::optional<StringMap> meta field, so
+  // code that reads it keeps compiling. A map without fields counts as unset.
+  // They return a const copy, fields are changed with set (or addMeta of
+  // MessageHeader), never through the returned map.
+  explicit operator bool() const { return !empty(); }
+  StringMap const get() const { return toStringMap(); }
+  StringMap const operator*() const { return toStringMap(); }
+
+  // assign replaces all fields with the string fields of the given
+  // velocypack object.
+  void assign(VSlice const& object);
+  // assignLazy is like assign, but the object is only decoded when the map is
+  // accessed for the first time. The object must stay valid until then.
+  // The first access is not thread-safe.
+  void assignLazy(VSlice const& object);
+  // decode decodes a lazily assigned object (if any).
+  inline void decode() const {
+    if (_lazy != nullptr) {
+      const_cast<HeaderMap*>(this)->decodeLazy();
+    }
+  }
+
+ private:
+  Field const* find(HeaderKey id, boost::string_ref lowerKey) const;
+  void append(boost::string_ref key, HeaderKey id, boost::string_ref value);
+  void replaceValue(Field& field, boost::string_ref value);
+  void fieldChanged(Field const& field);
+  void decodeLazy();
+
+ private:
+  std::string _buffer;
+  std::vector<Field> _fields;
+  ContentType _contentType;
+  ContentType _acceptType;
+  uint8_t const* _lazy;  // velocypack object that is not decoded yet
+};
+
 // mabye get rid of optional
 struct MessageHeader {
   MessageHeader(MessageHeader const&) = default;
   MessageHeader() = default;
   MessageHeader(MessageHeader&&) = default;
+  MessageHeader& operator=(MessageHeader const&) = default;
+  MessageHeader& operator=(MessageHeader&&) = default;
 
   ::boost::optional<int> version;
   ::boost::optional<MessageType> type;        // Type of message
@@ -52,7 +176,7 @@ struct MessageHeader {
   ::boost::optional<RestVerb> restVerb;       // HTTP method
   ::boost::optional<std::string> path;        // Local path of the request
   ::boost::optional<StringMap> parameters;    // Query parameters
-  ::boost::optional<StringMap> meta;          // Header meta data
+  HeaderMap meta;                             // Header meta data
   ::boost::optional<std::string> encryption;  // Authentication: encryption field
   ::boost::optional<std::string> user;        // Authentication: username
   ::boost::optional<std::string> password;    // Authentication: password
@@ -129,6 +253,63 @@ public:
   ContentType acceptType() const;
 };
 
+// MappedFile maps a region of a file read-only into memory, so it can be
+// send without copying it (see Request::addVPack / Request::addBinary).
+// The mapping lives as long as the last message that references it.
+class MappedFile {
+public:
+  // Throws when the file cannot be opened or mapped, or when the region
+  // does not fit into the file.
+  explicit MappedFile(std::string const& path, std::size_t offset = 0,
+                      ::boost::optional<std::size_t> length = ::boost::none);
+  // Maps a region of an open file. The descriptor is not closed and may be
+  // closed as soon as the constructor returns.
+  MappedFile(int fd, std::size_t offset, std::size_t length);
+  ~MappedFile();
+
+  // Prevent copying
+  MappedFile(MappedFile const& other) = delete;
+  MappedFile& operator=(MappedFile const& other) = delete;
+
+  uint8_t const* data() const { return _data; }
+  std::size_t size() const { return _size; }
+
+private:
+  void map(int fd, std::size_t offset, std::string const& name);
+
+private:
+  void* _mapping;          // start of the mapping (page aligned)
+  std::size_t _mappingLength;
+  uint8_t const* _data;    // start of the region
+  std::size_t _size;
+};
+
+// RequestBodySource produces the body of a request while the request is
+// sent, so the body never has to be in memory as a whole.
+// A source can only be read once, so a request with a body source is not
+// resent when its connection fails.
+class RequestBodySource {
+public:
+  virtual ~RequestBodySource() {}
+
+  // read copies up to length bytes of the body to the given buffer and
+  // returns the number of bytes copied. 0 is returned at the end of the body.
+  // Throws when the body cannot be produced.
+  virtual std::size_t read(uint8_t* buffer, std::size_t length) = 0;
+  // size returns the length of the body, if it is known up front.
+  virtual ::boost::optional<std::size_t> size() const { return ::boost::none; }
+};
+
+// RequestBodyReader pulls the next part of a body (see RequestBodySource::read).
+using RequestBodyReader = std::function<std::size_t(uint8_t* buffer, std::size_t length)>;
+
+// bodySourceFromReader creates a body source that pulls the body from the given reader.
+std::shared_ptr<RequestBodySource> bodySourceFromReader(RequestBodyReader reader,
+                                                        ::boost::optional<std::size_t> size = ::boost::none);
+// bodySourceFromFile creates a body source that reads the given file.
+// Throws when the file cannot be opened.
+std::shared_ptr<RequestBodySource> bodySourceFromFile(std::string const& path);
+
 // Request contains the message send to a server in a request.
 class Request : public Message {
   static std::chrono::milliseconds _defaultTimeout;
@@ -164,6 +345,13 @@ public:
   void addVPack(VBuffer&& buffer);
   void addBinary(uint8_t const* data, std::size_t length);
   void addBinarySingle(VBuffer&& buffer);
+  // add the content of a mapped file without copying it.
+  // The request must not have a payload.
+  void addVPack(std::shared_ptr<MappedFile> file);
+  void addBinary(std::shared_ptr<MappedFile> file);
+  // addBodySource makes the request take its body from the given source
+  // while it is sent. The request must not have a payload.
+  void addBodySource(std::shared_ptr<RequestBodySource> source);
 
   // content-type header accessors
   void contentType(std::string const& type);
@@ -184,6 +372,18 @@ public:
   // set timeout 
   void timeout(std::chrono::milliseconds timeout) { _timeout = timeout; }
 
+  // streamResponse makes the connection pass the body of the response to the
+  // given callback as it arrives, instead of buffering it.
+  // The RequestCallback is still called once the response is complete, with
+  // a Response that carries the header only.
+  // The callback is called on the io thread of the connection and must not throw.
+  void streamResponse(ResponseDataCallback callback) { _responseDataCallback = std::move(callback); }
+  // get the body source (nullptr unless the body is streamed)
+  std::shared_ptr<RequestBodySource> const& bodySource() const { return _bodySource; }
+
+  // get the data callback (empty unless the response is streamed)
+  ResponseDataCallback const& responseDataCallback() const { return _responseDataCallback; }
+
 private:
   VBuffer _payload;
   bool _sealed;
@@ -194,13 +394,17 @@ private:
   std::size_t _payloadLength; // because VPackBuffer has quirks we need
                               // to track the Length manually
   std::chrono::milliseconds _timeout;
+  std::shared_ptr<MappedFile> _mappedFile;  // payload when it is a mapped file
+  std::shared_ptr<RequestBodySource> _bodySource;
+  ResponseDataCallback _responseDataCallback;
 };
 
 // Response contains the message resulting from a request to a server.
 class Response : public Message {
 public:
   Response(MessageHeader&& messageHeader = MessageHeader(), StringMap&& headerStrings = StringMap())
-    : Message(std::move(messageHeader), std::move(headerStrings))
+    : Message(std::move(messageHeader), std::move(headerStrings)),
+      _payloadOffset(0)
           {
             header.type = MessageType::Response;
           }
@@ -237,9 +441,12 @@ public:
   virtual boost::asio::const_buffer payload() const override; 
 
   void setPayload(VBuffer&& buffer, size_t payloadOffset);
+  // Use the given mapping as payload (see ConnectionBuilder::responseSpillThreshold).
+  void setPayload(std::shared_ptr<MappedFile> file, size_t payloadOffset);
 
 private:
   VBuffer _payload;
+  std::shared_ptr<MappedFile> _mappedPayload; // payload when it was spilled to a file
   size_t _payloadOffset;
   std::vector<VSlice> _slices;
 };
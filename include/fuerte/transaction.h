@@ -0,0 +1,142 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#ifndef ARANGO_CXX_DRIVER_TRANSACTION
+#define ARANGO_CXX_DRIVER_TRANSACTION
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "collection.h"
+#include "types.h"
+#include "message.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 {
+
+class Connection;
+
+// TransactionOptions describe the collections of a stream transaction.
+struct TransactionOptions {
+  TransactionOptions()
+    : waitForSync(false)
+    , maxDocuments(1000)
+    {}
+
+  std::vector<std::string> read;      // collections that are read
+  std::vector<std::string> write;     // collections that are written
+  std::vector<std::string> exclusive; // collections that are written exclusively
+  bool waitForSync;
+  std::size_t maxDocuments;           // documents per request
+};
+
+// Transaction runs document operations in a stream transaction
+// (see Database::beginTransaction).
+// Operations return immediately and are sent in the order they were made,
+// one request at a time, since the server does not allow concurrent
+// requests in one transaction. Operations that are made while a request is
+// in flight are queued, consecutive operations of the same kind on the same
+// collection are sent together as one array request. Callbacks get the
+// result of their document like the callbacks of Collection.
+// When the transaction could not be started, every operation gets the error
+// object of the begin request.
+// A Transaction that is destroyed without commit or abort is aborted.
+class Transaction : public std::enable_shared_from_this<Transaction> {
+  friend class Database;
+
+  public:
+    ~Transaction();
+
+    // Prevent copying
+    Transaction(Transaction const& other) = delete;
+    Transaction& operator=(Transaction const& other) = delete;
+
+    // insert stores a new document in the given collection.
+    void insert(std::string const& collection, VSlice const& document, DocumentCallback cb);
+    // update merges the given attributes into the document with the same _key.
+    void update(std::string const& collection, VSlice const& document, DocumentCallback cb);
+    // replace replaces the document with the same _key.
+    void replace(std::string const& collection, VSlice const& document, DocumentCallback cb);
+    // drop removes a document, given as key string or as object with _key.
+    void drop(std::string const& collection, VSlice const& document, DocumentCallback cb);
+
+    // commit commits the transaction after all operations were sent.
+    // No operations may follow.
+    void commit(DocumentCallback cb);
+    // abort aborts the transaction after all operations were sent.
+    // No operations may follow.
+    void abort(DocumentCallback cb);
+
+    // id returns the id of the transaction (empty until it was started).
+    std::string id();
+
+  private:
+    // Run is one request of the transaction.
+    struct Run {
+      enum Kind { Begin, Documents, Commit, Abort };
+
+      Run(Kind k) : kind(k), verb(RestVerb::Post), entries(0) {}
+
+      Kind kind;
+      RestVerb verb;                  // Documents only
+      std::string collection;         // Documents only
+      std::unique_ptr<VBuilder> body; // documents or begin options
+      std::size_t entries;            // number of documents
+      std::vector<DocumentCallback> callbacks;
+    };
+
+    Transaction(std::shared_ptr<Connection> conn, std::string const& database,
+                std::size_t maxDocuments);
+
+    // begin queues the request that starts the transaction.
+    void begin(TransactionOptions const& options);
+    // add queues a document operation.
+    void add(RestVerb verb, std::string const& collection, VSlice const& document, DocumentCallback cb);
+    // finish queues the commit or abort.
+    void finish(Run::Kind kind, DocumentCallback cb);
+    // sendNext sends the first queued run unless a request is in flight.
+    // Queued runs fail when the transaction could not be started.
+    void sendNext();
+    // request creates the request of the given run. Must be called with
+    // _mutex held.
+    std::unique_ptr<Request> request(Run& run);
+    // received handles the response (or error) of a run.
+    void received(std::shared_ptr<Run> run, Error error, std::unique_ptr<Response> response);
+
+  private:
+    std::shared_ptr<Connection> _conn;
+    std::string _database;
+    std::size_t _maxDocuments;
+
+    std::mutex _mutex;
+    std::deque<std::unique_ptr<Run>> _queue; // not yet sent
+    bool _sending;              // a request is in flight
+    bool _finished;             // commit or abort was queued
+    std::string _id;
+    Error _beginFailure;                   // error of a begin request that failed
+    std::unique_ptr<VBuilder> _beginError; // error object of a begin the server rejected
+};
+
+}}}
+#endif
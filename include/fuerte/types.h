@@ -29,6 +29,7 @@
 #include <velocypack/Buffer.h>
 #include <velocypack/Builder.h>
 
+#include <chrono>
 #include <map>
 #include <vector>
 #include <string>
@@ -47,6 +48,7 @@ using StatusCode = uint32_t;
 StatusCode const StatusOK = 200;
 StatusCode const StatusCreated = 201;
 StatusCode const StatusAccepted = 202;
+StatusCode const StatusNotModified = 304;
 StatusCode const StatusBadRequest = 400;
 StatusCode const StatusUnauthorized = 401;
 StatusCode const StatusForbidden = 403;
@@ -57,6 +59,11 @@ StatusCode const StatusConflict = 409;
 // RequestCallback is called for finished connection requests.
 // If the given Error is zero, the request succeeded, otherwise an error occurred.
 using RequestCallback = std::function<void(Error, std::unique_ptr<Request>, std::unique_ptr<Response>)>;
+// ResponseDataCallback is called with the fragments of a streamed response
+// body (see Request::streamResponse), in order, as they arrive.
+// The status code of the response is passed along, so error bodies can be
+// told apart from results.
+using ResponseDataCallback = std::function<void(StatusCode, uint8_t const* data, std::size_t length)>;
 // ConnectionFailureCallback is called when a connection encounters a failure 
 // that is not related to a specific request.
 // Examples are:
@@ -87,6 +94,10 @@ enum class ErrorCondition : Error {
   VstWriteError = 1103,
   CanceledDuringReset = 1104,
   MalformedURL = 1105,
+  HttpReadError = 1106,
+  HttpWriteError = 1107,
+  HttpProtocolError = 1108,
+  VstProtocolError = 1109,
 
   CurlError = 3000,
 
@@ -143,6 +154,7 @@ std::string to_string(TransportType type);
 
 enum class ContentType { Unset, Custom, VPack, Dump, Json, Html, Text };
 ContentType to_ContentType(std::string const& val);
+ContentType to_ContentType(char const* val, std::size_t length);
 std::string to_string(ContentType type);
 
 // -----------------------------------------------------------------------------
@@ -163,6 +175,33 @@ namespace vst {
     VST1_1
   };
 
+  // ValidationLevel controls how much of a received message is checked
+  // before it is used.
+  enum ValidationLevel {
+    ValidateHeader,   // velocypack Validator on the message header only (default)
+    ValidateNone,     // no checks beyond the header size, for trusted servers only
+    ValidateFull,     // velocypack Validator on the header and all payload slices
+    ValidateSampled   // ValidateFull for every n-th message, ValidateHeader otherwise
+  };
+
+}
+
+// -----------------------------------------------------------------------------
+// --SECTION--                                                             Http
+// -----------------------------------------------------------------------------
+
+namespace http {
+
+  enum HTTPVersion {
+    HTTP1_1,
+    HTTP2       // multiplexes all requests over a single connection
+  };
+
+  enum HTTPBackend {
+    CurlBackend,
+    AsioBackend // HTTP/1.1 directly on asio sockets, without libcurl
+  };
+
 }
 
 // -----------------------------------------------------------------------------
@@ -180,6 +219,19 @@ namespace detail {
       , _password("")
       , _maxChunkSize(5000ul) // in bytes
       , _vstVersion(vst::VST1_0)
+      , _vstValidation(vst::ValidateHeader)
+      , _vstValidationSampleRate(100)
+      , _httpVersion(http::HTTP1_1)
+      , _maxConcurrentStreams(0)
+      , _maxHostConnections(0)
+      , _httpBackend(http::CurlBackend)
+      , _httpPipelining(false)
+      , _shareHttpCaches(false)
+      , _responseSpillThreshold(0)
+      , _responseSpillDirectory("")
+      , _singleFlight(false)
+      , _responseCacheSize(0)
+      , _responseCacheTTL(1000)
       {}
 
     TransportType _connType; // vst or http
@@ -191,6 +243,19 @@ namespace detail {
     std::string _password;
     std::size_t _maxChunkSize;
     vst::VSTVersion _vstVersion;
+    vst::ValidationLevel _vstValidation;
+    std::size_t _vstValidationSampleRate; // ValidateSampled only
+    http::HTTPVersion _httpVersion;
+    std::size_t _maxConcurrentStreams; // 0 = library default
+    std::size_t _maxHostConnections;   // 0 = unlimited
+    http::HTTPBackend _httpBackend;
+    bool _httpPipelining;              // AsioBackend only
+    bool _shareHttpCaches;             // CurlBackend only
+    std::size_t _responseSpillThreshold; // 0 = keep responses in memory
+    std::string _responseSpillDirectory; // empty = $TMPDIR or /tmp
+    bool _singleFlight;
+    std::size_t _responseCacheSize;          // 0 = no response cache
+    std::chrono::milliseconds _responseCacheTTL;
     ConnectionFailureCallback _onFailure;
   };
 
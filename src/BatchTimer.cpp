@@ -0,0 +1,43 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BatchTimer.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace impl {
+
+BatchTimer::BatchTimer(Connection& connection)
+  : _timer(*connection._eventLoopService.io_service()) {}
+
+void BatchTimer::start(std::chrono::microseconds delay, std::function<void()> fn) {
+  _timer.expires_from_now(boost::posix_time::microseconds(delay.count()));
+  _timer.async_wait([fn](boost::system::error_code const& error) {
+    if (!error) {
+      fn();
+    }
+  });
+}
+
+void BatchTimer::cancel() {
+  _timer.cancel();
+}
+
+}}}}
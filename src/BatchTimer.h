@@ -0,0 +1,51 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#ifndef ARANGO_CXX_DRIVER_BATCH_TIMER_H
+#define ARANGO_CXX_DRIVER_BATCH_TIMER_H 1
+
+#include <chrono>
+#include <functional>
+
+#include <boost/asio/deadline_timer.hpp>
+
+#include <fuerte/connection.h>
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace impl {
+
+// BatchTimer calls a function on the event loop of a connection once a
+// batch has waited long enough to be sent.
+// Not thread safe, callers serialize access.
+class BatchTimer {
+ public:
+  explicit BatchTimer(Connection& connection);
+
+  // start calls fn after the given delay, unless cancel is called first.
+  void start(std::chrono::microseconds delay, std::function<void()> fn);
+  void cancel();
+
+ private:
+  ::boost::asio::deadline_timer _timer;
+};
+
+}}}}
+#endif
@@ -0,0 +1,216 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "CachingConnection.h"
+
+#include <fuerte/helper.h>
+
+#include "xxhash.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace impl {
+
+CachingConnection::CachingConnection(std::shared_ptr<Connection> connection,
+                                     EventLoopService& eventLoopService,
+                                     detail::ConnectionConfiguration const& conf)
+  : Connection(eventLoopService, conf)
+  , _connection(std::move(connection))
+  , _cache(std::make_shared<Cache>(conf._responseCacheSize))
+  {}
+
+MessageID CachingConnection::sendRequest(std::unique_ptr<Request> request, RequestCallback cb) {
+  auto identity = requestIdentity(*request);
+  if (identity.empty()) {
+    RestVerb verb = request->header.restVerb ? request->header.restVerb.get() : RestVerb::Get;
+    if (verb != RestVerb::Get && verb != RestVerb::Head) {
+      // the request may change what is cached below its path
+      _cache->invalidate(pathKey(*request));
+    }
+    return _connection->sendRequest(std::move(request), std::move(cb));
+  }
+  uint64_t hash = XXH64(identity.data(), identity.size(), 0xdeadbeef);
+
+  std::shared_ptr<Response const> cached;
+  std::string etag;
+  {
+    std::lock_guard<std::mutex> lock(_cache->mutex);
+    auto entry = _cache->find(hash, identity);
+    if (entry != nullptr) {
+      if (std::chrono::steady_clock::now() - entry->stored < _configuration._responseCacheTTL) {
+        cached = entry->response;
+      } else {
+        etag = entry->etag;
+      }
+    }
+  }
+
+  if (cached) {
+    // deliver the hit on the event loop, like any other response
+    auto cache = _cache;
+    cache->pending++;
+    auto req = std::make_shared<std::unique_ptr<Request>>(std::move(request));
+    _eventLoopService.io_service()->post([cache, cached, req, cb]() {
+      cache->pending--;
+      cb(0, std::move(*req), copyResponse(*cached));
+    });
+    return 0;
+  }
+
+  auto path = pathKey(*request);
+  if (etag.empty()) {
+    return _connection->sendRequest(std::move(request), storing(_cache, hash, identity, path, cb));
+  }
+
+  // revalidate with a copy, the caller gets its request back unchanged
+  std::unique_ptr<Request> revalidation(new Request(MessageHeader(request->header), StringMap()));
+  revalidation->timeout(request->timeout());
+  revalidation->header.addMeta("if-none-match", etag);
+  auto cache = _cache;
+  auto original = std::make_shared<std::unique_ptr<Request>>(std::move(request));
+  std::weak_ptr<Connection> connection = _connection;
+  return _connection->sendRequest(std::move(revalidation),
+      [cache, connection, hash, identity, path, original, cb](Error error, std::unique_ptr<Request>, std::unique_ptr<Response> response) {
+    if (error != 0 || !response || response->statusCode() != StatusNotModified) {
+      storing(cache, hash, identity, path, cb)(error, std::move(*original), std::move(response));
+      return;
+    }
+    std::shared_ptr<Response const> cached;
+    {
+      std::lock_guard<std::mutex> lock(cache->mutex);
+      auto entry = cache->find(hash, identity);
+      if (entry != nullptr) {
+        entry->stored = std::chrono::steady_clock::now();
+        cached = entry->response;
+      }
+    }
+    if (cached) {
+      cb(0, std::move(*original), copyResponse(*cached));
+      return;
+    }
+    // the entry was dropped meanwhile, ask for the whole response
+    auto conn = connection.lock();
+    if (!conn) {
+      cb(errorToInt(ErrorCondition::ConnectionError), std::move(*original), nullptr);
+      return;
+    }
+    try {
+      conn->sendRequest(std::move(*original), storing(cache, hash, identity, path, cb));
+    } catch (std::exception const&) {
+      cb(errorToInt(ErrorCondition::ConnectionError), nullptr, nullptr);
+    }
+  });
+}
+
+RequestCallback CachingConnection::storing(std::shared_ptr<Cache> const& cache, uint64_t hash,
+                                           std::string const& identity, std::string const& path,
+                                           RequestCallback cb) {
+  return [cache, hash, identity, path, cb](Error error, std::unique_ptr<Request> request, std::unique_ptr<Response> response) {
+    if (error == 0 && response) {
+      if (response->statusCode() == StatusOK) {
+        cache->store(hash, identity, path, copyResponse(*response));
+      } else {
+        cache->erase(hash, identity);
+      }
+    }
+    cb(error, std::move(request), std::move(response));
+  };
+}
+
+std::size_t CachingConnection::requestsLeft() {
+  return _connection->requestsLeft() + _cache->pending.load();
+}
+
+std::string CachingConnection::pathKey(Request const& request) {
+  std::string key(request.header.database ? request.header.database.get() : "");
+  key.push_back('\0');
+  key.append(request.header.path ? request.header.path.get() : "");
+  return key;
+}
+
+CachingConnection::Entry* CachingConnection::Cache::find(uint64_t hash, std::string const& identity) {
+  auto it = index.find(hash);
+  if (it == index.end() || it->second->identity != identity) {
+    return nullptr;
+  }
+  entries.splice(entries.begin(), entries, it->second);
+  return &entries.front();
+}
+
+void CachingConnection::Cache::store(uint64_t hash, std::string const& identity, std::string path, std::unique_ptr<Response> response) {
+  // decode the meta data now, cached responses are read concurrently
+  std::string etag = response->header.metaByKey("etag");
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = index.find(hash);
+  if (it != index.end()) {
+    // replaces the entry of this or of another request with the same hash,
+    // the latter may be below another path
+    auto& entry = *it->second;
+    if (entry.identity != identity) {
+      paths.erase(entry.path);
+      entry.path = paths.emplace(std::move(path), hash);
+    }
+    entry.identity = identity;
+    entry.response = std::move(response);
+    entry.etag = std::move(etag);
+    entry.stored = std::chrono::steady_clock::now();
+    entries.splice(entries.begin(), entries, it->second);
+    return;
+  }
+
+  while (!entries.empty() && entries.size() >= capacity) {
+    // evict the least recently used entry
+    auto& last = entries.back();
+    paths.erase(last.path);
+    index.erase(last.hash);
+    entries.pop_back();
+  }
+  entries.push_front(Entry{hash, identity, paths.emplace(std::move(path), hash),
+                           std::move(response), std::move(etag),
+                           std::chrono::steady_clock::now()});
+  index.emplace(hash, entries.begin());
+}
+
+void CachingConnection::Cache::erase(uint64_t hash, std::string const& identity) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = index.find(hash);
+  if (it != index.end() && it->second->identity == identity) {
+    paths.erase(it->second->path);
+    entries.erase(it->second);
+    index.erase(it);
+  }
+}
+
+void CachingConnection::Cache::invalidate(std::string const& prefix) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = paths.lower_bound(prefix);
+  while (it != paths.end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+    auto entry = index.find(it->second);
+    if (entry != index.end()) {
+      entries.erase(entry->second);
+      index.erase(entry);
+    }
+    it = paths.erase(it);
+  }
+}
+
+}}}}
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef ARANGO_CXX_DRIVER_CACHING_CONNECTION_H
+#define ARANGO_CXX_DRIVER_CACHING_CONNECTION_H 1
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <fuerte/connection.h>
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace impl {
+
+// CachingConnection sends requests through another connection and keeps the
+// successful responses of GET requests in a bounded LRU cache, keyed by the
+// hash of the request identity (see requestIdentity).
+// Entries younger than the configured TTL are answered without asking the
+// server. Older entries with an ETag are revalidated with If-None-Match (on a
+// copy of the request), a 304 answer is served from the cache. When the entry
+// was dropped while it was revalidated, the request is sent once more without
+// If-None-Match. Other requests drop the entries below their path.
+// See ConnectionBuilder::responseCacheSize.
+class CachingConnection : public Connection {
+ public:
+  CachingConnection(std::shared_ptr<Connection> connection,
+                    EventLoopService& eventLoopService,
+                    detail::ConnectionConfiguration const& conf);
+
+  // Start an asynchronous request.
+  // Requests answered from the cache return message ID 0.
+  MessageID sendRequest(std::unique_ptr<Request>, RequestCallback) override;
+  // Return the number of unfinished requests.
+  std::size_t requestsLeft() override;
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    std::string identity; // compared on lookup, hashes may collide
+    std::multimap<std::string, uint64_t>::iterator path;
+    std::shared_ptr<Response const> response;
+    std::string etag;
+    std::chrono::steady_clock::time_point stored;
+  };
+
+  // The cache is shared with the callbacks, which may outlive the connection.
+  struct Cache {
+    Cache(std::size_t c) : capacity(c), pending(0) {}
+
+    std::mutex mutex;
+    std::size_t const capacity;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    std::multimap<std::string, uint64_t> paths; // database & path of entries
+    std::atomic<std::size_t> pending; // cache hits not yet delivered
+
+    // find returns the entry of the given request or nullptr.
+    // Must be called with mutex held.
+    Entry* find(uint64_t hash, std::string const& identity);
+    void store(uint64_t hash, std::string const& identity, std::string path, std::unique_ptr<Response> response);
+    void erase(uint64_t hash, std::string const& identity);
+    // erase all entries of requests below the given database & path.
+    void invalidate(std::string const& prefix);
+  };
+
+  // pathKey returns the database & path of a request.
+  static std::string pathKey(Request const& request);
+  // storing returns a callback that stores a successful response before it
+  // passes it on.
+  static RequestCallback storing(std::shared_ptr<Cache> const& cache, uint64_t hash,
+                                 std::string const& identity, std::string const& path,
+                                 RequestCallback cb);
+
+ private:
+  std::shared_ptr<Connection> _connection;
+  std::shared_ptr<Cache> _cache;
+};
+
+}}}}
+#endif
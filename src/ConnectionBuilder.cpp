@@ -26,7 +26,10 @@
 #include <fuerte/connection.h>
 #include <fuerte/waitgroup.h>
 
+#include "CachingConnection.h"
+#include "HttpAsioConnection.h"
 #include "HttpConnection.h"
+#include "SingleFlightConnection.h"
 #include "VstConnection.h"
 
 namespace arangodb { namespace fuerte { inline namespace v1 {
@@ -38,6 +41,12 @@ std::shared_ptr<Connection> ConnectionBuilder::connect(EventLoopService& eventLo
   if (_conf._connType == TransportType::Vst){
     FUERTE_LOG_DEBUG << "fuerte - creating velocystream connection" << std::endl;
     result = std::make_shared<vst::VstConnection>(eventLoopService, _conf);
+  } else if (_conf._httpBackend == http::AsioBackend) {
+    if (_conf._httpVersion != http::HTTP1_1) {
+      throw std::invalid_argument("the asio http backend only supports HTTP/1.1");
+    }
+    FUERTE_LOG_DEBUG << "fuerte - creating asio http connection" << std::endl;
+    result = std::make_shared<http::HttpAsioConnection>(eventLoopService, _conf);
   } else {
     //throw std::logic_error("http in vst test");
     FUERTE_LOG_DEBUG << "fuerte - creating http connection" << std::endl;
@@ -46,6 +55,13 @@ std::shared_ptr<Connection> ConnectionBuilder::connect(EventLoopService& eventLo
   // Start the connection implementation
   result->start();
 
+  if (_conf._singleFlight) {
+    result = std::make_shared<impl::SingleFlightConnection>(result, eventLoopService, _conf);
+  }
+  if (_conf._responseCacheSize > 0) {
+    result = std::make_shared<impl::CachingConnection>(result, eventLoopService, _conf);
+  }
+
   return result;
 }
 
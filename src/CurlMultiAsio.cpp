@@ -62,6 +62,7 @@ CurlMultiAsio::CurlMultiAsio(boost::asio::io_service& io_service, CurlMultiAsio:
   _io_service(io_service),
   _request_done_cb(request_done_cb),
   _timer(io_service),
+  _sockets(std::make_shared<CurlSockets>(io_service)),
   #if ENABLE_FUERTE_LOG_HTTPTRACE > 0
     _pendingAsyncCalls(0),
   #endif
@@ -80,6 +81,32 @@ CurlMultiAsio::CurlMultiAsio(boost::asio::io_service& io_service, CurlMultiAsio:
   curl_multi_setopt(_multi, CURLMOPT_TIMERDATA, this);
 }
 
+// Initialize out CURL MULTI using the HTTP settings of the given configuration.
+CurlMultiAsio::CurlMultiAsio(boost::asio::io_service& io_service, detail::ConnectionConfiguration const& configuration,
+                             std::shared_ptr<CurlShare> share, CurlMultiAsio::RequestDoneCallback request_done_cb) :
+  CurlMultiAsio(io_service, request_done_cb) {
+
+  if (share) {
+    _share = share;
+    _sockets = share->sockets();
+  }
+
+  if (configuration._httpVersion == http::HTTP2) {
+    // Let all easy handles share the streams of a single HTTP/2 connection
+    curl_multi_setopt(_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#if LIBCURL_VERSION_NUM >= 0x074300
+    if (configuration._maxConcurrentStreams > 0) {
+      curl_multi_setopt(_multi, CURLMOPT_MAX_CONCURRENT_STREAMS,
+                        static_cast<long>(configuration._maxConcurrentStreams));
+    }
+#endif
+  }
+  if (configuration._maxHostConnections > 0) {
+    curl_multi_setopt(_multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+                      static_cast<long>(configuration._maxHostConnections));
+  }
+}
+
 // Cleanup
 CurlMultiAsio::~CurlMultiAsio() {
   {
@@ -96,10 +123,10 @@ CurlMultiAsio::~CurlMultiAsio() {
 // It configures callbacks needed to connect the sockets.
 void CurlMultiAsio::addRequest(CURL *easyHandle) {
   // Initialize callback
-  curl_easy_setopt(easyHandle, CURLOPT_OPENSOCKETFUNCTION, bind_open_socket);
-  curl_easy_setopt(easyHandle, CURLOPT_OPENSOCKETDATA, this);
-  curl_easy_setopt(easyHandle, CURLOPT_CLOSESOCKETFUNCTION, bind_close_socket);
-  curl_easy_setopt(easyHandle, CURLOPT_CLOSESOCKETDATA, this);
+  _sockets->attach(easyHandle);
+  if (_share) {
+    _share->attach(easyHandle);
+  }
  
   FUERTE_LOG_HTTPTRACE << "Adding easy " << easyHandle << " to our multi" << std::endl;
   {
@@ -253,11 +280,33 @@ void CurlMultiAsio::event_cb(curl_socket_t s, int action,
   FUERTE_LOG_HTTPTRACE << "event_cb: socket=" << s << " action=" << curlWhat(action) << " async-calls=" << ctr << " socketp=" << socketp << std::endl;
 #endif
 
+  if (error == boost::asio::error::operation_aborted) {
+    // the socket is no longer watched (see remove_socket)
+    return;
+  }
+
   int still_running;
   {
     std::lock_guard<std::recursive_mutex> lock(_multi_mutex);
+    auto it = _socketInfos.find(s);
+    if (it != _socketInfos.end()) {
+      it->second->armed &= ~action;
+    }
+
     auto rc = curl_multi_socket_action(_multi, s, action, &still_running);
     assertCurlOK("event_cb: curl_multi_socket_action", rc);
+
+    // asio waits for a socket once, but curl only calls socket_cb when the
+    // action changes. Keep waiting as long as curl wants this action
+    // (e.g. while a request body is being written).
+    it = _socketInfos.find(s);
+    if (!error && it != _socketInfos.end() &&
+        (it->second->action & action) && !(it->second->armed & action)) {
+      auto tcp_socket = _sockets->find(s);
+      if (tcp_socket != nullptr) {
+        watch_socket(tcp_socket, s, action, it->second);
+      }
+    }
   }
   check_multi_info(still_running);
 
@@ -275,51 +324,40 @@ void CurlMultiAsio::set_socket(CurlMultiAsio::SocketInfo *socketp, curl_socket_t
   FUERTE_LOG_HTTPTRACE << "set_socket: socket=" << s << ", action=" << curlWhat(action) << ", oldAction=" << curlWhat(oldAction) << " socketp=" << socketp << std::endl;
 
   // Lookup tcp_socket for the given curl socket.
-  boost::asio::ip::tcp::socket * tcp_socket = nullptr;
-  {
-    std::lock_guard<std::mutex> lock(_map_mutex);
-    auto it = _socket_map.find(s);
-    if(it == _socket_map.end()) {
-      FUERTE_LOG_HTTPTRACE << "socket " << s << " is a c-ares socket, ignoring" << std::endl;
-      return;
-    }
-    tcp_socket = it->second;
+  auto tcp_socket = _sockets->find(s);
+  if (tcp_socket == nullptr) {
+    FUERTE_LOG_HTTPTRACE << "socket " << s << " is a c-ares socket, ignoring" << std::endl;
+    return;
   }
  
   // Store action for later
   socketp->action = action;
  
+  // Only wait for what we are not waiting for already, pending waits are
+  // continued by event_cb.
+  if ((action & CURL_POLL_IN) && !(socketp->armed & CURL_POLL_IN)) {
+    FUERTE_LOG_HTTPTRACE << "watching for socket to become readable socketp=" << socketp << std::endl;
+    watch_socket(tcp_socket, s, CURL_POLL_IN, socketp);
+  }
+  if ((action & CURL_POLL_OUT) && !(socketp->armed & CURL_POLL_OUT)) {
+    FUERTE_LOG_HTTPTRACE << "watching for socket to become writable socketp=" << socketp << std::endl;
+    watch_socket(tcp_socket, s, CURL_POLL_OUT, socketp);
+  }
+}
+
+// Wait (once) for the given socket to become readable (CURL_POLL_IN) or writable (CURL_POLL_OUT).
+void CurlMultiAsio::watch_socket(boost::asio::ip::tcp::socket* tcp_socket, curl_socket_t s, int action, SocketInfo *socketp)
+{
   auto self = shared_from_this();
-  switch (action) {
-    case CURL_POLL_IN:
-      FUERTE_LOG_HTTPTRACE << "watching for socket to become readable socketp=" << socketp << std::endl;
-      //if (oldAction != CURL_POLL_IN && oldAction != CURL_POLL_INOUT) {
-        recordNewAsyncCall("set_socket: CURL_POLL_IN");
-        tcp_socket->async_read_some(boost::asio::null_buffers(),
-                                    boost::bind(&CurlMultiAsio::event_cb, self, s, CURL_POLL_IN, _1, socketp));
-      //}
-      break;
-    case CURL_POLL_OUT:
-      FUERTE_LOG_HTTPTRACE << "watching for socket to become writable socketp=" << socketp << std::endl;
-      //if (oldAction != CURL_POLL_OUT && oldAction != CURL_POLL_INOUT) {
-        recordNewAsyncCall("set_socket CURL_POLL_OUT");
-        tcp_socket->async_write_some(boost::asio::null_buffers(),
-                                    boost::bind(&CurlMultiAsio::event_cb, self, s, CURL_POLL_OUT, _1, socketp));
-      //}
-      break;
-    case CURL_POLL_INOUT:
-      FUERTE_LOG_HTTPTRACE << "watching for socket to become readable & writable socketp=" << socketp << std::endl;
-      //if (oldAction != CURL_POLL_IN && oldAction != CURL_POLL_INOUT) {
-        recordNewAsyncCall("set_socket: CURL_POLL_INOUT IN");
-        tcp_socket->async_read_some(boost::asio::null_buffers(),
-                                    boost::bind(&CurlMultiAsio::event_cb, self, s, CURL_POLL_IN, _1, socketp));
-      //}
-      //if (oldAction != CURL_POLL_OUT && oldAction != CURL_POLL_INOUT) {
-        recordNewAsyncCall("set_socket: CURL_POLL_INOUT OUT");
-        tcp_socket->async_write_some(boost::asio::null_buffers(),
-                                    boost::bind(&CurlMultiAsio::event_cb, self, s, CURL_POLL_OUT, _1, socketp));
-      //}
-      break;
+  socketp->armed |= action;
+  if (action == CURL_POLL_IN) {
+    recordNewAsyncCall("watch_socket: CURL_POLL_IN");
+    tcp_socket->async_read_some(boost::asio::null_buffers(),
+                                boost::bind(&CurlMultiAsio::event_cb, self, s, CURL_POLL_IN, _1, socketp));
+  } else {
+    recordNewAsyncCall("watch_socket: CURL_POLL_OUT");
+    tcp_socket->async_write_some(boost::asio::null_buffers(),
+                                 boost::bind(&CurlMultiAsio::event_cb, self, s, CURL_POLL_OUT, _1, socketp));
   }
 }
  
@@ -327,10 +365,11 @@ void CurlMultiAsio::set_socket(CurlMultiAsio::SocketInfo *socketp, curl_socket_t
 void CurlMultiAsio::add_socket(curl_socket_t s, CURL *easy, int action)
 {
   /* fdp is used to store current action */ 
-  auto socketp = new CurlMultiAsio::SocketInfo{.action = 0};
+  auto socketp = new CurlMultiAsio::SocketInfo{.action = 0, .armed = 0};
   {
     std::unique_lock<std::recursive_mutex> lock(_multi_mutex);
     curl_multi_assign(_multi, s, socketp);
+    _socketInfos[s] = socketp;
   }
 
   // Continue
@@ -344,20 +383,14 @@ void CurlMultiAsio::remove_socket(CurlMultiAsio::SocketInfo *socketp, curl_socke
   {
     std::unique_lock<std::recursive_mutex> lock(_multi_mutex);
     curl_multi_assign(_multi, s, nullptr);
+    _socketInfos.erase(s);
   }
   if (socketp) {
     delete socketp;
   }
 
   // Find the tcp socket and cancel any pending async calls.
-  boost::asio::ip::tcp::socket * tcp_socket = nullptr;
-  {
-    std::lock_guard<std::mutex> lock(_map_mutex);
-    auto it = _socket_map.find(s);
-    if (it != _socket_map.end()) {
-      tcp_socket = it->second;
-    }
-  }
+  auto tcp_socket = _sockets->find(s);
   if (tcp_socket != nullptr) {
     try {
       tcp_socket->cancel();
@@ -390,74 +423,6 @@ int CurlMultiAsio::socket_cb(CURL *easy,      /* easy handle */
  
   return 0;
 }
- 
-// Open a socket (CURLOPT_OPENSOCKETFUNCTION callback  function)
-curl_socket_t CurlMultiAsio::open_socket(curlsocktype purpose, struct curl_sockaddr *address)
-{
-  FUERTE_LOG_HTTPTRACE << "open_socket" << std::endl;
- 
-  curl_socket_t sockfd = CURL_SOCKET_BAD;
- 
-  // restrict to IPv4 
-  if (purpose == CURLSOCKTYPE_IPCXN) {
-    /* create a tcp socket object */
-    auto tcp_socket = new boost::asio::ip::tcp::socket(_io_service);
-
-    /* open it and get the native handle*/ 
-    boost::system::error_code ec;
-    if (address->family == AF_INET) {
-      tcp_socket->open(boost::asio::ip::tcp::v4(), ec);
-    } else if (address->family == AF_INET6) {
-      tcp_socket->open(boost::asio::ip::tcp::v6(), ec);
-    } else {
-      FUERTE_LOG_ERROR << "Couldn't open socket with family " << address->family << std::endl;
-      return sockfd;
-    }
- 
-    if (ec) {
-      // An error occurred 
-      FUERTE_LOG_ERROR << "Couldn't open socket [" << ec << "][" << ec.message() << "]" << std::endl;
-      FUERTE_LOG_HTTPTRACE << "ERROR: Returning CURL_SOCKET_BAD to signal error" << std::endl;
-    }
-    else {
-      sockfd = tcp_socket->native_handle();
-      FUERTE_LOG_HTTPTRACE << "Opened socket " << sockfd << std::endl;
- 
-      // save the socket mapping
-      {
-        std::unique_lock<std::mutex> lock(_map_mutex);
-        _socket_map.insert(std::pair<curl_socket_t, boost::asio::ip::tcp::socket *>(sockfd, tcp_socket));
-      }
-    }
-  }
-
-  FUERTE_LOG_HTTPTRACE << "open_socket done; returning socket " << sockfd << std::endl;
- 
-  return sockfd;
-}
- 
-// Close a socket (CURLOPT_CLOSESOCKETFUNCTION callback function)
-int CurlMultiAsio::close_socket(curl_socket_t item)
-{
-  FUERTE_LOG_HTTPTRACE << "close_socket: " << item << std::endl;
- 
-  {
-    std::unique_lock<std::mutex> lock(_map_mutex);
-    auto it = _socket_map.find(item); 
-    if (it != _socket_map.end()) {
-      auto tcp_socket = it->second;
-      try {
-        tcp_socket->cancel();
-      } catch (...) {
-        // Just ignore
-      }
-      delete tcp_socket;
-      _socket_map.erase(it);
-    }
-  }
- 
-  return 0;
-}
 
 }
 }
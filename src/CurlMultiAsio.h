@@ -34,6 +34,8 @@
 
 #include <atomic>
 
+#include "CurlShare.h"
+
 namespace arangodb {
 namespace fuerte {
 inline namespace v1 {
@@ -45,6 +47,9 @@ class CurlMultiAsio : public std::enable_shared_from_this<CurlMultiAsio> {
   using RequestDoneCallback = std::function<void(CURL* easyHandle, CURLcode result)>;
 
   CurlMultiAsio(boost::asio::io_service& io_service, RequestDoneCallback request_done_cb);
+  // When a share is given, all requests use its caches and sockets.
+  CurlMultiAsio(boost::asio::io_service& io_service, detail::ConnectionConfiguration const& configuration,
+                std::shared_ptr<CurlShare> share, RequestDoneCallback request_done_cb);
   ~CurlMultiAsio();
 
   // Prevent copying
@@ -62,7 +67,8 @@ class CurlMultiAsio : public std::enable_shared_from_this<CurlMultiAsio> {
 
  private:
   typedef struct {
-    int action;
+    int action;   // what curl wants to know about the socket
+    int armed;    // what we are waiting for (CURL_POLL_IN / CURL_POLL_OUT bits)
   } SocketInfo;
 
   // Check for completed transfers, and remove their easy handles 
@@ -71,15 +77,13 @@ class CurlMultiAsio : public std::enable_shared_from_this<CurlMultiAsio> {
   int multi_timer_cb(CURLM *multi, long timeout_ms, void *userp);
   // Called by asio when our timeout expires
   void timer_cb(const boost::system::error_code & error);
-  // Open a socket (CURLOPT_OPENSOCKETFUNCTION callback function)
-  curl_socket_t open_socket(curlsocktype purpose, struct curl_sockaddr *address);
-  // Close a socket (CURLOPT_CLOSESOCKETFUNCTION callback function)
-  int close_socket(curl_socket_t item);
   // Called by asio when there is an action on a socket 
   void event_cb(curl_socket_t s, int action, const boost::system::error_code & error, SocketInfo *socketp);
   // CURLMOPT_SOCKETFUNCTION callback
   int socket_cb(CURL* easy, curl_socket_t s, int what, void* userp, SocketInfo* socketp);
   void set_socket(SocketInfo *socketp, curl_socket_t s, CURL *easy, int action, int oldAction);
+  // Wait (once) for the given socket to become readable (CURL_POLL_IN) or writable (CURL_POLL_OUT).
+  void watch_socket(boost::asio::ip::tcp::socket* tcp_socket, curl_socket_t s, int action, SocketInfo *socketp);
   // Allocate SocketInfo for given socket.
   void add_socket(curl_socket_t s, CURL *easy, int action);
   // Clean up any SocketInfo data
@@ -97,12 +101,6 @@ class CurlMultiAsio : public std::enable_shared_from_this<CurlMultiAsio> {
   static int bind_socket_cb(CURL *easy, curl_socket_t s, int what, void *userp, SocketInfo *socketp) {
     return static_cast<CurlMultiAsio*>(userp)->socket_cb(easy, s, what, userp, socketp);
   }
-  static curl_socket_t bind_open_socket(void *userp, curlsocktype purpose, struct curl_sockaddr *address) {
-    return static_cast<CurlMultiAsio*>(userp)->open_socket(purpose, address);
-  }
-  static int bind_close_socket(void *userp, curl_socket_t item) {
-    return static_cast<CurlMultiAsio*>(userp)->close_socket(item);
-  }
 
 
  private:
@@ -112,8 +110,9 @@ class CurlMultiAsio : public std::enable_shared_from_this<CurlMultiAsio> {
   CURLM* _multi;
   std::mutex _timer_mutex;
   boost::asio::deadline_timer _timer;
-  std::mutex _map_mutex;
-  std::map<curl_socket_t, boost::asio::ip::tcp::socket*> _socket_map;
+  std::shared_ptr<CurlShare> _share;    // optional
+  std::shared_ptr<CurlSockets> _sockets; // ours or the ones of the share
+  std::map<curl_socket_t, SocketInfo*> _socketInfos; // sockets watched for curl (guarded by _multi_mutex)
   int _requests_left;
 
  private:
@@ -0,0 +1,183 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#include "CurlShare.h"
+
+#include <stdexcept>
+
+#include <fuerte/FuerteLogger.h>
+
+namespace arangodb {
+namespace fuerte {
+inline namespace v1 {
+namespace http {
+
+// -----------------------------------------------------------------------------
+// --SECTION--                                                      CurlSockets
+// -----------------------------------------------------------------------------
+
+CurlSockets::CurlSockets(boost::asio::io_service& io_service) :
+  _io_service(io_service) {}
+
+CurlSockets::~CurlSockets() {
+  std::lock_guard<std::mutex> lock(_map_mutex);
+  for (auto& it : _socket_map) {
+    delete it.second;
+  }
+  _socket_map.clear();
+}
+
+// attach lets the given CURL EASY handle open & close its sockets through us.
+void CurlSockets::attach(CURL* easyHandle) {
+  curl_easy_setopt(easyHandle, CURLOPT_OPENSOCKETFUNCTION, bind_open_socket);
+  curl_easy_setopt(easyHandle, CURLOPT_OPENSOCKETDATA, this);
+  curl_easy_setopt(easyHandle, CURLOPT_CLOSESOCKETFUNCTION, bind_close_socket);
+  curl_easy_setopt(easyHandle, CURLOPT_CLOSESOCKETDATA, this);
+}
+
+// find returns the asio socket for the given curl socket or nullptr.
+boost::asio::ip::tcp::socket* CurlSockets::find(curl_socket_t s) {
+  std::lock_guard<std::mutex> lock(_map_mutex);
+  auto it = _socket_map.find(s);
+  if (it == _socket_map.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+// Open a socket (CURLOPT_OPENSOCKETFUNCTION callback  function)
+curl_socket_t CurlSockets::open_socket(curlsocktype purpose, struct curl_sockaddr *address)
+{
+  FUERTE_LOG_HTTPTRACE << "open_socket" << std::endl;
+
+  curl_socket_t sockfd = CURL_SOCKET_BAD;
+
+  // restrict to IPv4
+  if (purpose == CURLSOCKTYPE_IPCXN) {
+    /* create a tcp socket object */
+    auto tcp_socket = new boost::asio::ip::tcp::socket(_io_service);
+
+    /* open it and get the native handle*/
+    boost::system::error_code ec;
+    if (address->family == AF_INET) {
+      tcp_socket->open(boost::asio::ip::tcp::v4(), ec);
+    } else if (address->family == AF_INET6) {
+      tcp_socket->open(boost::asio::ip::tcp::v6(), ec);
+    } else {
+      FUERTE_LOG_ERROR << "Couldn't open socket with family " << address->family << std::endl;
+      delete tcp_socket;
+      return sockfd;
+    }
+
+    if (ec) {
+      // An error occurred
+      FUERTE_LOG_ERROR << "Couldn't open socket [" << ec << "][" << ec.message() << "]" << std::endl;
+      FUERTE_LOG_HTTPTRACE << "ERROR: Returning CURL_SOCKET_BAD to signal error" << std::endl;
+      delete tcp_socket;
+    }
+    else {
+      sockfd = tcp_socket->native_handle();
+      FUERTE_LOG_HTTPTRACE << "Opened socket " << sockfd << std::endl;
+
+      // save the socket mapping
+      {
+        std::unique_lock<std::mutex> lock(_map_mutex);
+        _socket_map.insert(std::pair<curl_socket_t, boost::asio::ip::tcp::socket *>(sockfd, tcp_socket));
+      }
+    }
+  }
+
+  FUERTE_LOG_HTTPTRACE << "open_socket done; returning socket " << sockfd << std::endl;
+
+  return sockfd;
+}
+
+// Close a socket (CURLOPT_CLOSESOCKETFUNCTION callback function)
+int CurlSockets::close_socket(curl_socket_t item)
+{
+  FUERTE_LOG_HTTPTRACE << "close_socket: " << item << std::endl;
+
+  {
+    std::unique_lock<std::mutex> lock(_map_mutex);
+    auto it = _socket_map.find(item);
+    if (it != _socket_map.end()) {
+      auto tcp_socket = it->second;
+      try {
+        tcp_socket->cancel();
+      } catch (...) {
+        // Just ignore
+      }
+      delete tcp_socket;
+      _socket_map.erase(it);
+    }
+  }
+
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+// --SECTION--                                                        CurlShare
+// -----------------------------------------------------------------------------
+
+CurlShare::CurlShare(boost::asio::io_service& io_service) :
+  _share(curl_share_init()),
+  _sockets(std::make_shared<CurlSockets>(io_service)) {
+  if (!_share) {
+    throw std::logic_error("curl_share_init failed");
+  }
+
+  // The share is used by multiple CURL MULTI's that run on different threads.
+  curl_share_setopt(_share, CURLSHOPT_LOCKFUNC, &CurlShare::lock);
+  curl_share_setopt(_share, CURLSHOPT_UNLOCKFUNC, &CurlShare::unlock);
+  curl_share_setopt(_share, CURLSHOPT_USERDATA, this);
+
+  curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  // The connection cache is not shared: a cached connection would be used by
+  // CURL MULTI's on other threads while its socket is watched by the
+  // io_service of the one that opened it.
+}
+
+CurlShare::~CurlShare() {
+  auto rc = curl_share_cleanup(_share);
+  if (rc != CURLSHE_OK) {
+    FUERTE_LOG_ERROR << "curl_share_cleanup failed: " << curl_share_strerror(rc) << std::endl;
+  }
+}
+
+// attach makes the given CURL EASY handle use this share.
+void CurlShare::attach(CURL* easyHandle) {
+  curl_easy_setopt(easyHandle, CURLOPT_SHARE, _share);
+}
+
+void CurlShare::lock(CURL*, curl_lock_data data, curl_lock_access, void* userp) {
+  static_cast<CurlShare*>(userp)->_locks[data].lock();
+}
+
+void CurlShare::unlock(CURL*, curl_lock_data data, void* userp) {
+  static_cast<CurlShare*>(userp)->_locks[data].unlock();
+}
+
+}
+}
+}
+}
@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#ifndef ARANGO_CXX_DRIVER_CURL_SHARE_H
+#define ARANGO_CXX_DRIVER_CURL_SHARE_H 1
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <boost/asio.hpp>
+#include <curl/curl.h>
+
+namespace arangodb {
+namespace fuerte {
+inline namespace v1 {
+namespace http {
+
+// CurlSockets keeps the asio sockets that back the sockets opened by curl.
+// curl opens and closes its sockets through the callbacks installed by attach,
+// so asio can watch them.
+class CurlSockets {
+ public:
+  explicit CurlSockets(boost::asio::io_service& io_service);
+  ~CurlSockets();
+
+  // Prevent copying
+  CurlSockets(CurlSockets const& other) = delete;
+  CurlSockets& operator=(CurlSockets const& other) = delete;
+
+  // attach lets the given CURL EASY handle open & close its sockets through us.
+  void attach(CURL* easyHandle);
+
+  // find returns the asio socket for the given curl socket or nullptr
+  // when the socket was not opened by us (e.g. c-ares sockets).
+  boost::asio::ip::tcp::socket* find(curl_socket_t s);
+
+ private:
+  // Open a socket (CURLOPT_OPENSOCKETFUNCTION callback function)
+  curl_socket_t open_socket(curlsocktype purpose, struct curl_sockaddr *address);
+  // Close a socket (CURLOPT_CLOSESOCKETFUNCTION callback function)
+  int close_socket(curl_socket_t item);
+
+  static curl_socket_t bind_open_socket(void *userp, curlsocktype purpose, struct curl_sockaddr *address) {
+    return static_cast<CurlSockets*>(userp)->open_socket(purpose, address);
+  }
+  static int bind_close_socket(void *userp, curl_socket_t item) {
+    return static_cast<CurlSockets*>(userp)->close_socket(item);
+  }
+
+ private:
+  boost::asio::io_service& _io_service;
+  std::mutex _map_mutex;
+  std::map<curl_socket_t, boost::asio::ip::tcp::socket*> _socket_map;
+};
+
+// CurlShare shares the DNS cache and TLS sessions between all CURL EASY
+// handles attached to it, even when they are driven by different
+// CurlMultiAsio instances (i.e. different HttpConnections).
+// Connections are not shared, every CURL MULTI keeps its own.
+class CurlShare {
+ public:
+  explicit CurlShare(boost::asio::io_service& io_service);
+  ~CurlShare();
+
+  // Prevent copying
+  CurlShare(CurlShare const& other) = delete;
+  CurlShare& operator=(CurlShare const& other) = delete;
+
+  // attach makes the given CURL EASY handle use this share.
+  void attach(CURL* easyHandle);
+
+  // sockets returns the socket map that must be used by all handles of this share.
+  std::shared_ptr<CurlSockets> const& sockets() const { return _sockets; }
+
+ private:
+  // CURLSHOPT_LOCKFUNC / CURLSHOPT_UNLOCKFUNC callbacks
+  static void lock(CURL* handle, curl_lock_data data, curl_lock_access access, void* userp);
+  static void unlock(CURL* handle, curl_lock_data data, void* userp);
+
+ private:
+  CURLSH* _share;
+  std::shared_ptr<CurlSockets> _sockets;
+  std::mutex _locks[CURL_LOCK_DATA_LAST];
+};
+
+}
+}
+}
+}
+
+#endif
@@ -0,0 +1,210 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#include <fuerte/requests.h>
+#include <velocypack/Collection.h>
+
+#include "DocumentBatcher.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace impl {
+
+DocumentBatcher::DocumentBatcher(std::shared_ptr<Connection> connection,
+                                 std::string const& database, RestVerb verb,
+                                 std::string const& path,
+                                 BatchOptions const& options,
+                                 StringMap const& parameters)
+  : _connection(connection)
+  , _database(database)
+  , _verb(verb)
+  , _path(path)
+  , _parameters(parameters)
+  , _options(options)
+  , _timer(*connection)
+  , _timerArmed(false)
+  {}
+
+DocumentBatcher::~DocumentBatcher() {
+  Batch batch;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    batch = take();
+  }
+  send(std::move(batch));
+}
+
+void DocumentBatcher::add(VSlice const& document, DocumentCallback cb) {
+  Batch batch;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto index = append(document);
+    _pending.callbacks.emplace_back(index, std::move(cb));
+    batch = queued();
+  }
+  send(std::move(batch));
+}
+
+void DocumentBatcher::addKey(std::string const& key, DocumentCallback cb) {
+  Batch batch;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _pending.keys.find(key);
+    if (it != _pending.keys.end()) {
+      // share the result of the pending lookup
+      _pending.callbacks.emplace_back(it->second, std::move(cb));
+      return;
+    }
+    VBuilder keyBuilder;
+    keyBuilder.add(VValue(key));
+    auto index = append(keyBuilder.slice());
+    _pending.keys.emplace(key, index);
+    _pending.callbacks.emplace_back(index, std::move(cb));
+    batch = queued();
+  }
+  send(std::move(batch));
+}
+
+void DocumentBatcher::merge(VSlice const& patch, DocumentCallback cb) {
+  Batch batch;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    VSlice key = patch.isObject() ? patch.get("_key") : VSlice();
+    auto it = key.isString() ? _pending.keys.find(key.copyString()) : _pending.keys.end();
+    if (it != _pending.keys.end()) {
+      // later attributes win, nested objects are merged like the server does
+      auto& pending = _pending.patches[it->second];
+      std::unique_ptr<VBuilder> merged(new VBuilder(
+          ::arangodb::velocypack::Collection::merge(pending->slice(), patch, true, false)));
+      _pending.bytes += merged->slice().byteSize();
+      _pending.bytes -= pending->slice().byteSize();
+      pending = std::move(merged);
+      _pending.callbacks.emplace_back(it->second, std::move(cb));
+      return;
+    }
+    std::unique_ptr<VBuilder> builder(new VBuilder());
+    builder->add(patch);
+    auto index = _pending.entries++;
+    _pending.bytes += patch.byteSize();
+    _pending.patches.push_back(std::move(builder));
+    if (key.isString()) {
+      _pending.keys.emplace(key.copyString(), index);
+    }
+    _pending.callbacks.emplace_back(index, std::move(cb));
+    batch = queued();
+  }
+  send(std::move(batch));
+}
+
+void DocumentBatcher::flush() {
+  Batch batch;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    batch = take();
+  }
+  send(std::move(batch));
+}
+
+std::size_t DocumentBatcher::append(VSlice const& document) {
+  if (!_pending.documents) {
+    _pending.documents.reset(new VBuilder());
+    _pending.documents->openArray();
+  }
+  _pending.documents->add(document);
+  _pending.bytes += document.byteSize();
+  return _pending.entries++;
+}
+
+DocumentBatcher::Batch DocumentBatcher::queued() {
+  if (_pending.entries >= _options.maxDocuments ||
+      _pending.bytes >= _options.maxBytes ||
+      _options.linger.count() == 0) {
+    return take();
+  }
+  if (!_timerArmed) {
+    // the timer must not keep the batcher alive
+    std::weak_ptr<DocumentBatcher> weak = shared_from_this();
+    _timerArmed = true;
+    _timer.start(_options.linger, [weak]() {
+      auto self = weak.lock();
+      if (self) {
+        self->flush();
+      }
+    });
+  }
+  return Batch();
+}
+
+DocumentBatcher::Batch DocumentBatcher::take() {
+  if (_timerArmed) {
+    _timer.cancel();
+    _timerArmed = false;
+  }
+  Batch batch;
+  std::swap(batch, _pending);
+  return batch;
+}
+
+void DocumentBatcher::send(Batch batch) {
+  if (batch.callbacks.empty()) {
+    return;
+  }
+  if (!batch.patches.empty()) {
+    batch.documents.reset(new VBuilder());
+    batch.documents->openArray();
+    for (auto const& patch : batch.patches) {
+      batch.documents->add(patch->slice());
+    }
+  }
+  batch.documents->close();
+  auto request = createRequest(_verb, _path, _parameters, batch.documents->slice());
+  request->header.database = _database;
+
+  // the callbacks are owned by the request, so the batcher may go away
+  auto entries = batch.entries;
+  auto callbacks = std::make_shared<std::vector<std::pair<std::size_t, DocumentCallback>>>(std::move(batch.callbacks));
+  _connection->sendRequest(std::move(request), [entries, callbacks](Error error, std::unique_ptr<Request>, std::unique_ptr<Response> response) {
+    if (error != 0 || !response) {
+      for (auto& cb : *callbacks) {
+        cb.second(error != 0 ? error : errorToInt(ErrorCondition::ConnectionError), VSlice());
+      }
+      return;
+    }
+    VSlice results;
+    try {
+      auto const& slices = response->slices();
+      if (!slices.empty()) {
+        results = slices.front();
+      }
+    } catch (std::exception const&) {
+      for (auto& cb : *callbacks) {
+        cb.second(errorToInt(ErrorCondition::ErrorCastError), VSlice());
+      }
+      return;
+    }
+    bool perDocument = results.isArray() && results.length() == entries;
+    for (auto& cb : *callbacks) {
+      // a request that failed as a whole reports one error object for all
+      cb.second(0, perDocument ? results.at(cb.first) : results);
+    }
+  });
+}
+
+}}}}
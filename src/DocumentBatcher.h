@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#ifndef ARANGO_CXX_DRIVER_DOCUMENT_BATCHER_H
+#define ARANGO_CXX_DRIVER_DOCUMENT_BATCHER_H 1
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fuerte/collection.h>
+#include <fuerte/connection.h>
+#include <fuerte/types.h>
+
+#include "BatchTimer.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace impl {
+
+// DocumentBatcher collects single document operations of one kind and
+// sends them as one array request. The result array of the response is
+// handed back to the callers document by document.
+class DocumentBatcher : public std::enable_shared_from_this<DocumentBatcher> {
+ public:
+  DocumentBatcher(std::shared_ptr<Connection> connection,
+                  std::string const& database, RestVerb verb,
+                  std::string const& path, BatchOptions const& options,
+                  StringMap const& parameters = StringMap());
+  // Pending documents are sent.
+  ~DocumentBatcher();
+
+  // Prevent copying
+  DocumentBatcher(DocumentBatcher const& other) = delete;
+  DocumentBatcher& operator=(DocumentBatcher const& other) = delete;
+
+  // add queues a document, the batch is sent when it is full.
+  void add(VSlice const& document, DocumentCallback cb);
+  // addKey queues a document key. A key that is already pending is not
+  // queued again, all its callers get the same result.
+  void addKey(std::string const& key, DocumentCallback cb);
+  // merge queues a patch. A patch for a _key that is already pending is
+  // merged into the pending one, all its callers get the same result.
+  // A batcher must not mix merge with add or addKey.
+  void merge(VSlice const& patch, DocumentCallback cb);
+  // flush sends the pending documents now.
+  void flush();
+
+ private:
+  // Documents that are sent together.
+  struct Batch {
+    Batch() : entries(0), bytes(0) {}
+
+    std::unique_ptr<VBuilder> documents;
+    std::vector<std::unique_ptr<VBuilder>> patches; // documents of merge, built on send
+    std::size_t entries;  // number of documents
+    std::size_t bytes;    // size of the documents
+    std::vector<std::pair<std::size_t, DocumentCallback>> callbacks; // document index, callback
+    std::unordered_map<std::string, std::size_t> keys;               // key -> document index (addKey, merge)
+  };
+
+  // append adds a document to the pending batch and returns its index.
+  // Must be called with _mutex held.
+  std::size_t append(VSlice const& document);
+  // queued takes the pending batch when it is full, otherwise it makes sure
+  // the batch is sent after the linger time. Must be called with _mutex held.
+  Batch queued();
+  // take removes the pending batch. Must be called with _mutex held.
+  Batch take();
+  // send sends the given batch.
+  void send(Batch batch);
+
+ private:
+  std::shared_ptr<Connection> _connection;
+  std::string _database;
+  RestVerb _verb;
+  std::string _path;
+  StringMap _parameters;
+  BatchOptions _options;
+
+  std::mutex _mutex;
+  Batch _pending;
+  BatchTimer _timer;
+  bool _timerArmed;
+};
+
+}}}}
+#endif
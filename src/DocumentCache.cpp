@@ -0,0 +1,194 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#include <velocypack/Iterator.h>
+
+#include "DocumentCache.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace impl {
+
+namespace {
+bool isSystemAttribute(std::string const& name) {
+  return name == "_key" || name == "_id" || name == "_rev";
+}
+
+// compact copies the document into a buffer of its own. Attribute names are
+// added by name, so the default options translate the system attributes.
+// The _key, _id & _rev of meta (if it is an object) replace those of the
+// document.
+std::shared_ptr<VBuffer const> compact(VSlice const& document, VSlice const& meta) {
+  VBuilder builder;
+  builder.openObject();
+  if (meta.isObject()) {
+    for (std::string name : {"_key", "_id", "_rev"}) {
+      VSlice value = meta.get(name);
+      if (!value.isNone()) {
+        builder.add(name, value);
+      }
+    }
+  }
+  for (auto const& it : ::arangodb::velocypack::ObjectIterator(document)) {
+    std::string name = it.key.makeKey().copyString();
+    if (meta.isObject() && isSystemAttribute(name)) {
+      continue;
+    }
+    builder.add(name, it.value);
+  }
+  builder.close();
+
+  auto slice = builder.slice();
+  std::shared_ptr<VBuffer> buffer(new VBuffer(slice.byteSize()));
+  buffer->append(slice.start(), slice.byteSize());
+  return buffer;
+}
+}
+
+DocumentCache::DocumentCache(CacheOptions const& options)
+  : _options(options)
+  , _hand(0)
+  , _bytes(0)
+  , _epoch(0)
+  {}
+
+std::shared_ptr<VBuffer const> DocumentCache::find(std::string const& key) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = _keys.find(key);
+  if (it == _keys.end()) {
+    return nullptr;
+  }
+  auto& slot = _slots[it->second];
+  slot.referenced = true;
+  return slot.document;
+}
+
+uint64_t DocumentCache::epoch() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _epoch;
+}
+
+void DocumentCache::store(VSlice const& document, uint64_t epoch) {
+  if (!document.isObject()) {
+    return;
+  }
+  VSlice key = document.get("_key");
+  if (!key.isString() || !document.get("_rev").isString()) {
+    return;
+  }
+  auto compacted = compact(document, VSlice());
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (epoch == _epoch) {
+    insert(key.copyString(), std::move(compacted));
+  }
+}
+
+void DocumentCache::store(VSlice const& document, VSlice const& result) {
+  if (!document.isObject() || !result.isObject()) {
+    return;
+  }
+  VSlice key = result.get("_key");
+  if (!key.isString() || !result.get("_rev").isString()) {
+    return;
+  }
+  auto compacted = compact(document, result);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  // reads that are in flight may return an older revision
+  _epoch++;
+  insert(key.copyString(), std::move(compacted));
+}
+
+void DocumentCache::erase(std::string const& key) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _epoch++;
+  auto it = _keys.find(key);
+  if (it != _keys.end()) {
+    remove(it->second);
+  }
+}
+
+void DocumentCache::clear() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _epoch++;
+  _slots.clear();
+  _free.clear();
+  _keys.clear();
+  _hand = 0;
+  _bytes = 0;
+}
+
+void DocumentCache::insert(std::string const& key, std::shared_ptr<VBuffer const> document) {
+  auto it = _keys.find(key);
+  if (it != _keys.end()) {
+    remove(it->second);
+  }
+  std::size_t bytes = key.size() + document->size();
+  if (bytes > _options.maxBytes) {
+    return;
+  }
+  evict(bytes);
+
+  std::size_t index;
+  if (_free.empty()) {
+    index = _slots.size();
+    _slots.emplace_back();
+  } else {
+    index = _free.back();
+    _free.pop_back();
+  }
+  auto& slot = _slots[index];
+  slot.key = key;
+  slot.document = std::move(document);
+  slot.referenced = false;
+  _keys.emplace(key, index);
+  _bytes += bytes;
+}
+
+void DocumentCache::remove(std::size_t index) {
+  auto& slot = _slots[index];
+  _bytes -= slot.key.size() + slot.document->size();
+  _keys.erase(slot.key);
+  slot.key.clear();
+  slot.document.reset();
+  slot.referenced = false;
+  _free.push_back(index);
+}
+
+void DocumentCache::evict(std::size_t bytes) {
+  while (_bytes + bytes > _options.maxBytes && !_keys.empty()) {
+    if (_hand >= _slots.size()) {
+      _hand = 0;
+    }
+    auto& slot = _slots[_hand];
+    if (slot.document) {
+      if (slot.referenced) {
+        // second chance
+        slot.referenced = false;
+      } else {
+        remove(_hand);
+      }
+    }
+    _hand++;
+  }
+}
+
+}}}}
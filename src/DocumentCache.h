@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#ifndef ARANGO_CXX_DRIVER_DOCUMENT_CACHE_H
+#define ARANGO_CXX_DRIVER_DOCUMENT_CACHE_H 1
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fuerte/collection.h>
+#include <fuerte/types.h>
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace impl {
+
+// DocumentCache keeps documents of one collection by _key, up to a budget of
+// bytes. Documents are stored as velocypack whose system attributes are
+// translated with the attribute translator of VpackInit.
+// When the budget is exceeded documents are evicted with the CLOCK
+// algorithm: the hand sweeps over the slots and evicts the first document
+// that was not used since the hand passed it the last time.
+class DocumentCache {
+ public:
+  DocumentCache(CacheOptions const& options);
+
+  // Prevent copying
+  DocumentCache(DocumentCache const& other) = delete;
+  DocumentCache& operator=(DocumentCache const& other) = delete;
+
+  // find returns the document with the given key, or nullptr.
+  std::shared_ptr<VBuffer const> find(std::string const& key);
+  // epoch returns a value that changes whenever a document is removed.
+  // Documents read before the epoch changed must not be stored.
+  uint64_t epoch();
+  // store keeps a document that has a _key and _rev, read with the given
+  // epoch.
+  void store(VSlice const& document, uint64_t epoch);
+  // store keeps a written document with the _key, _id & _rev of the
+  // result of the write.
+  void store(VSlice const& document, VSlice const& result);
+  // erase removes the document with the given key.
+  void erase(std::string const& key);
+  // clear removes all documents.
+  void clear();
+
+ private:
+  struct Slot {
+    Slot() : referenced(false) {}
+
+    std::string key;
+    std::shared_ptr<VBuffer const> document; // nullptr = free slot
+    bool referenced;
+  };
+
+  // insert keeps the given document. Must be called with _mutex held.
+  void insert(std::string const& key, std::shared_ptr<VBuffer const> document);
+  // remove frees the given slot. Must be called with _mutex held.
+  void remove(std::size_t slot);
+  // evict frees slots until the given number of bytes fit into the budget.
+  // Must be called with _mutex held.
+  void evict(std::size_t bytes);
+
+ private:
+  CacheOptions _options;
+
+  std::mutex _mutex;
+  std::vector<Slot> _slots;
+  std::vector<std::size_t> _free;                    // indexes of free slots
+  std::unordered_map<std::string, std::size_t> _keys; // key -> slot
+  std::size_t _hand;
+  std::size_t _bytes;
+  uint64_t _epoch;
+};
+
+}}}}
+#endif
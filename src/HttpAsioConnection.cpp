@@ -0,0 +1,732 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <fuerte/FuerteLogger.h>
+#include <fuerte/helper.h>
+#include <fuerte/loop.h>
+#include <fuerte/message.h>
+#include <fuerte/types.h>
+
+#include "HttpAsioConnection.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace http {
+
+using namespace arangodb::fuerte::detail;
+
+namespace ba = ::boost::asio;
+namespace bs = ::boost::asio::ssl;
+using bt = ::boost::asio::ip::tcp;
+using BoostEC = ::boost::system::error_code;
+
+HttpAsioConnection::HttpAsioConnection(EventLoopService& eventLoopService, ConnectionConfiguration const& configuration)
+    : Connection(eventLoopService, configuration)
+    , _messageID(0)
+    , _hostHeader(configuration._host + ":" + configuration._port)
+    , _resolver(new bt::resolver(*eventLoopService.io_service()))
+    , _ioService(eventLoopService.io_service())
+    , _socket(nullptr)
+    , _context(bs::context::method::sslv23)
+    , _sslSocket(nullptr)
+    , _connecting(false)
+    , _connected(false)
+    , _async_calls(0)
+{
+  if (configuration._authenticationType == AuthenticationType::Basic) {
+    _authorization = basicAuthorization(configuration._user, configuration._password);
+  }
+  assert(!_readLoop._current);
+  assert(!_writeLoop._current);
+}
+
+// Deconstruct.
+HttpAsioConnection::~HttpAsioConnection() {
+  _resolver->cancel();
+  shutdownConnection();
+  for (auto& item : _sendQueue.takeAll()) {
+    item->invokeOnError(errorToInt(ErrorCondition::CanceledDuringReset), std::move(item->_request), nullptr);
+  }
+}
+
+// Activate this connection.
+void HttpAsioConnection::start() {
+  _connecting = true;
+  startResolveHost();
+}
+
+// sendRequest prepares a RequestItem for the given parameters
+// and adds it to the send queue.
+MessageID HttpAsioConnection::sendRequest(std::unique_ptr<Request> request, RequestCallback cb) {
+  auto item = createRequestItem(std::move(request), cb);
+  auto id = item->_messageID;
+
+  _sendQueue.add(item);
+
+  if (_connected) {
+    FUERTE_LOG_HTTPTRACE << "sendRequest: start writing" << std::endl;
+    startWriting();
+  } else if (!_connecting.exchange(true)) {
+    if (_connected) {
+      // connection came up in the meantime and will pick up the request
+      _connecting = false;
+      startWriting();
+    } else {
+      // the server closed the connection, open a new one
+      FUERTE_LOG_HTTPTRACE << "sendRequest: reconnecting" << std::endl;
+      startResolveHost();
+    }
+  }
+  return id;
+}
+
+// createRequestItem prepares a RequestItem for the given parameters.
+HttpAsioConnection::RequestItemSP HttpAsioConnection::createRequestItem(std::unique_ptr<Request> request, RequestCallback cb) {
+  if (_configuration._authenticationType == AuthenticationType::Jwt) {
+    throw std::invalid_argument("Jwt authentication is not yet support");
+  }
+
+  request->messageID = ++_messageID;
+  auto item = std::make_shared<RequestItem>();
+  item->_messageID = request->messageID;
+  item->_callback = cb;
+  item->_request = std::move(request);
+
+  appendRequestHead(item->_requestHead, *item->_request, _hostHeader, _authorization);
+  item->_bodySource = item->_request->bodySource();
+  if (item->_bodySource) {
+    // the body is read & written after the request head
+    auto size = item->_bodySource->size();
+    item->_bodyPending = true;
+    item->_bodyChunked = !size;
+    item->_bodyRemaining = size.value_or(0);
+  }
+  item->resetRequestBuffers();
+  return item;
+}
+
+// Point _requestBuffers at the request head (and the buffered body).
+void HttpAsioConnection::RequestItem::resetRequestBuffers() {
+  _requestBuffers.clear();
+  _requestBuffers.push_back(ba::buffer(_requestHead));
+  if (!_request->bodySource()) {
+    auto payload = _request->payload();
+    if (ba::buffer_size(payload) > 0) {
+      _requestBuffers.push_back(payload);
+    }
+  }
+}
+
+// Read the next part of a streamed body into _requestBuffers.
+// Returns false when the whole body has been written.
+bool HttpAsioConnection::RequestItem::nextBodyPart() {
+  static std::size_t const bodyPartSize = 64 * 1024;
+  static char const* const crlf = "\r\n";
+  static char const* const lastChunk = "0\r\n\r\n";
+
+  if (!_bodyPending) {
+    return false;
+  }
+  _requestBuffers.clear();
+
+  std::size_t wanted = bodyPartSize;
+  if (!_bodyChunked) {
+    if (_bodyRemaining == 0) {
+      _bodyPending = false;
+      _bodySource.reset();
+      return false;
+    }
+    wanted = std::min(wanted, _bodyRemaining);
+  }
+  _bodyPart.resize(wanted);
+  auto length = _bodySource->read(reinterpret_cast<uint8_t*>(&_bodyPart[0]), wanted);
+
+  if (!_bodyChunked) {
+    if (length == 0 || length > _bodyRemaining) {
+      throw std::runtime_error("request body does not match its announced size");
+    }
+    _bodyRemaining -= length;
+    _requestBuffers.push_back(ba::buffer(_bodyPart.data(), length));
+    return true;
+  }
+
+  if (length == 0) {
+    _bodyPending = false;
+    _bodySource.reset();
+    _requestBuffers.push_back(ba::buffer(lastChunk, 5));
+    return true;
+  }
+  _bodyPartHead.clear();
+  for (auto rest = length; rest > 0; rest >>= 4) {
+    _bodyPartHead.insert(_bodyPartHead.begin(), "0123456789abcdef"[rest & 0xf]);
+  }
+  _bodyPartHead.append(crlf);
+  _requestBuffers.push_back(ba::buffer(_bodyPartHead));
+  _requestBuffers.push_back(ba::buffer(_bodyPart.data(), length));
+  _requestBuffers.push_back(ba::buffer(crlf, 2));
+  return true;
+}
+
+std::size_t HttpAsioConnection::requestsLeft() {
+  // not exact (both queues would need to be locked), but good enough to
+  // decide if we need to wait for more responses.
+  return _sendQueue.size() + _inFlight.size();
+}
+
+// resolve the host into a series of endpoints
+void HttpAsioConnection::startResolveHost() {
+  auto self = shared_from_this();
+  _resolver->async_resolve({_configuration._host, _configuration._port},
+    [this, self](const BoostEC& error, bt::resolver::iterator iterator) {
+      if (error) {
+        FUERTE_LOG_DEBUG << "resolve failed: error=" << error << std::endl;
+        failConnect("resolved failed: error" + error.message());
+      } else {
+        FUERTE_LOG_CALLBACKS << "resolve succeeded" << std::endl;
+        _endpoints = iterator;
+        if (_endpoints == bt::resolver::iterator()) {
+          FUERTE_LOG_ERROR << "unable to resolve endpoints" << std::endl;
+          failConnect("unable to resolve endpoints");
+        } else {
+          initSocket();
+        }
+      }
+    });
+}
+
+// CONNECT RECONNECT //////////////////////////////////////////////////////////
+
+void HttpAsioConnection::initSocket() {
+  std::lock_guard<std::mutex> lock(_socket_mutex);
+
+  // socket must be empty before. Check that
+  assert(!_socket);
+  assert(!_sslSocket);
+
+  FUERTE_LOG_CALLBACKS << "begin init" << std::endl;
+  _socket.reset(new bt::socket(*_ioService));
+  if (_configuration._ssl) {
+    _sslSocket.reset(new bs::stream<bt::socket&>(*_socket, _context));
+  }
+
+  startConnect(_endpoints);
+}
+
+// close the TCP & SSL socket.
+void HttpAsioConnection::shutdownSocket() {
+  std::lock_guard<std::mutex> lock(_socket_mutex);
+
+  FUERTE_LOG_CALLBACKS << "begin shutdown socket" << std::endl;
+
+  BoostEC error;
+  if (_sslSocket) {
+    _sslSocket->shutdown(error);
+  }
+  if (_socket) {
+    _socket->cancel(error);
+    _socket->shutdown(bt::socket::shutdown_both, error);
+    _socket->close(error);
+  }
+  _sslSocket = nullptr;
+  _socket = nullptr;
+}
+
+// shutdown the connection and handle all requests that did not get a response.
+void HttpAsioConnection::shutdownConnection(const ErrorCondition error, const Unanswered unanswered) {
+  FUERTE_LOG_CALLBACKS << "shutdownConnection" << std::endl;
+
+  // Stop the read & write loop
+  stopWriting();
+  stopReading();
+  _connected = false;
+
+  // Close socket
+  shutdownSocket();
+
+  // Requests without a response are either resent on the next connection
+  // or cancelled.
+  std::deque<RequestItemSP> retry;
+  for (auto& item : _inFlight.takeAll()) {
+    // a body source has been read already and cannot be sent again
+    bool again = (unanswered == Unanswered::Retry && !item->_request->bodySource()) ||
+                 (unanswered == Unanswered::RetryIdempotent && item->isIdempotent() && item->_retries == 0);
+    if (again) {
+      item->_retries++;
+      item->resetRequestBuffers();
+      retry.push_back(std::move(item));
+    } else {
+      item->invokeOnError(errorToInt(error), std::move(item->_request), nullptr);
+    }
+  }
+  if (!retry.empty()) {
+    _sendQueue.insert(retry);
+  }
+}
+
+void HttpAsioConnection::restartConnection(const ErrorCondition error, const Unanswered unanswered) {
+  // Read & write loop must have been reset by now
+  assert(!_readLoop._current);
+  assert(!_writeLoop._current);
+
+  FUERTE_LOG_CALLBACKS << "restartConnection" << std::endl;
+  shutdownConnection(error, unanswered);
+
+  // Only connect again when there is work, otherwise the next
+  // sendRequest will do so.
+  if (!_sendQueue.empty() && !_connecting.exchange(true)) {
+    startResolveHost();
+  }
+}
+
+// ------------------------------------
+// Creating a connection
+// ------------------------------------
+
+// try to open the socket connection to the first endpoint.
+void HttpAsioConnection::startConnect(bt::resolver::iterator endpointItr) {
+  FUERTE_LOG_CALLBACKS << "trying to connect to: " << endpointItr->endpoint() << "..." << std::endl;
+
+  auto self = shared_from_this();
+  ba::async_connect(*_socket, endpointItr,
+    [this, self](BoostEC const& error, bt::resolver::iterator endpoint) {
+      asyncConnectCallback(error, endpoint);
+    });
+}
+
+// callback handler for async_connect (called in startConnect).
+void HttpAsioConnection::asyncConnectCallback(BoostEC const& error, bt::resolver::iterator endpointItr) {
+  if (error) {
+    // Connection failed
+    FUERTE_LOG_DEBUG << error.message() << std::endl;
+    shutdownConnection(ErrorCondition::CouldNotConnect);
+    failConnect("unable to connect -- " + error.message());
+  } else {
+    // Connection established
+    FUERTE_LOG_CALLBACKS << "TCP socket connected" << std::endl;
+    if (_configuration._ssl) {
+      startSSLHandshake();
+    } else {
+      finishInitialization();
+    }
+  }
+}
+
+// start intiating an SSL connection (on top of an established TCP socket)
+void HttpAsioConnection::startSSLHandshake() {
+  FUERTE_LOG_CALLBACKS << "starting ssl handshake " << std::endl;
+  // send the host name (SNI), so virtual hosts present the right certificate
+  SSL_set_tlsext_host_name(_sslSocket->native_handle(), _configuration._host.c_str());
+
+  auto self = shared_from_this();
+  _sslSocket->async_handshake(
+      bs::stream_base::client, [this, self](BoostEC const& error) {
+        if (error) {
+          FUERTE_LOG_ERROR << error.message() << std::endl;
+          shutdownConnection(ErrorCondition::CouldNotConnect);
+          failConnect("unable to perform ssl handshake: error=" + error.message());
+        } else {
+          FUERTE_LOG_CALLBACKS << "ssl handshake done" << std::endl;
+          finishInitialization();
+        }
+      });
+}
+
+// socket connection is up (with optional SSL), start sending requests.
+void HttpAsioConnection::finishInitialization() {
+  FUERTE_LOG_CALLBACKS << "HTTP connection established; starting send/read loop" << std::endl;
+  _connected = true;
+  _connecting = false;
+  startWriting();
+}
+
+// connecting failed, fail all queued requests.
+void HttpAsioConnection::failConnect(std::string const& message) {
+  _connecting = false;
+  onFailure(errorToInt(ErrorCondition::CouldNotConnect), message);
+  for (auto& item : _sendQueue.takeAll()) {
+    item->invokeOnError(errorToInt(ErrorCondition::CouldNotConnect), std::move(item->_request), nullptr);
+  }
+}
+
+// ------------------------------------
+// Reading data
+// ------------------------------------
+
+// activate the receiver loop (if needed)
+void HttpAsioConnection::startReading() {
+  ReadLoop *newLoop;
+  {
+    std::lock_guard<std::mutex> lock(_readLoop._mutex);
+    if (_readLoop._current) {
+      // There is already a read loop, do nothing
+      return;
+    }
+    // There is no current read loop, create one
+    _readLoop._current = std::make_shared<ReadLoop>(
+        std::dynamic_pointer_cast<HttpAsioConnection>(shared_from_this()), _socket, _sslSocket);
+    newLoop = _readLoop._current.get();
+  }
+  // Start the new loop
+  newLoop->start();
+}
+
+// Stop the current read loop
+void HttpAsioConnection::stopReading() {
+  std::lock_guard<std::mutex> lock(_readLoop._mutex);
+  _readLoop._current.reset();
+}
+
+// called by a ReadLoop to decide if it must stop.
+// returns true when the given loop should stop.
+bool HttpAsioConnection::shouldStopReading(const ReadLoop* readLoop, std::chrono::milliseconds& timeout) {
+  // Claim exclusive access
+  std::unique_lock<std::mutex> readLoopLock(_readLoop._mutex, std::defer_lock);
+  std::unique_lock<std::mutex> queueLock(_sendQueue.mutex(), std::defer_lock);
+  std::unique_lock<std::mutex> inFlightLock(_inFlight.mutex(), std::defer_lock);
+  std::lock(readLoopLock, queueLock, inFlightLock);
+
+  // Is the read loop still the current read loop?
+  if (_readLoop._current.get() != readLoop) {
+    FUERTE_LOG_HTTPTRACE << "shouldStopReading: no longer current loop: loop=" << readLoop << std::endl;
+    return true;
+  }
+
+  // Is there any work left for the read loop?
+  if (_inFlight.empty(true) && _sendQueue.empty(true)) {
+    // No more work
+    _readLoop._current.reset();
+    FUERTE_LOG_HTTPTRACE << "shouldStopReading: no more pending requests, stopping read loop: loop=" << readLoop << std::endl;
+    return true;
+  }
+
+  // Continue read loop
+  timeout = _inFlight.minimumTimeout();
+  return false;
+}
+
+// Restart the connection if the given ReadLoop is still the current read loop.
+void HttpAsioConnection::restartConnection(const ReadLoop* readLoop, const ErrorCondition error, const Unanswered unanswered) {
+  {
+    // Claim read & write loop mutex, so we can prevent that the ReadLoop & WriteLoop each restart
+    // the connection, resulting in a double restart.
+    std::unique_lock<std::mutex> readLoopLock(_readLoop._mutex, std::defer_lock);
+    std::unique_lock<std::mutex> writeLoopLock(_writeLoop._mutex, std::defer_lock);
+    std::lock(readLoopLock, writeLoopLock);
+    if (_readLoop._current.get() != readLoop) {
+      return;
+    }
+    _readLoop._current.reset();
+    _writeLoop._current.reset();
+  }
+  restartConnection(error, unanswered);
+}
+
+// Prepare the given parser for the response to the oldest request that waits
+// for a response (HEAD requests, streamed responses).
+void HttpAsioConnection::resetParser(ResponseParser& parser) {
+  auto item = _inFlight.front();
+  if (!item) {
+    throw std::runtime_error("received data while no request is pending");
+  }
+  auto const& request = *item->_request;
+  parser.reset(request.header.restVerb.get() == RestVerb::Head,
+               request.responseDataCallback());
+}
+
+// Hand the given response to the oldest request that waits for a response.
+void HttpAsioConnection::processResponse(std::unique_ptr<Response> response) {
+  auto item = _inFlight.removeFirst();
+  assert(item);
+  FUERTE_LOG_HTTPTRACE << "processResponse: messageID=" << item->_messageID << std::endl;
+  response->messageID = item->_messageID;
+  item->_callback.invoke(0, std::move(item->_request), std::move(response));
+}
+
+// start the read loop
+void HttpAsioConnection::ReadLoop::start() {
+  auto wasStarted = _started.exchange(true);
+  if (!wasStarted) {
+    readNextBytes();
+  }
+}
+
+// readNextBytes reads the next bytes from the server.
+void HttpAsioConnection::ReadLoop::readNextBytes() {
+  // Ask the connection if we should terminate.
+  std::chrono::milliseconds timeout;
+  if (_connection->shouldStopReading(this, timeout)) {
+    FUERTE_LOG_HTTPTRACE << "readNextBytes: stopping read loop" << std::endl;
+    return;
+  }
+
+  // Set timeout
+  auto self = shared_from_this();
+  _deadline.expires_from_now(boost::posix_time::milliseconds(timeout.count()));
+  _deadline.async_wait(boost::bind(&ReadLoop::deadlineHandler, self, _1));
+
+  _connection->_async_calls++;
+  auto handler = boost::bind(&ReadLoop::asyncReadCallback, self, _1, _2);
+  if (_sslSocket) {
+    ba::async_read(*_sslSocket, _receiveBuffer, ba::transfer_at_least(1), handler);
+  } else {
+    ba::async_read(*_socket, _receiveBuffer, ba::transfer_at_least(1), handler);
+  }
+}
+
+// asyncReadCallback is called when readNextBytes is resulting in some data.
+void HttpAsioConnection::ReadLoop::asyncReadCallback(const BoostEC& error, std::size_t transferred) {
+  // Cancel deadline
+  _deadline.cancel();
+
+  auto pendingAsyncCalls = --_connection->_async_calls;
+  if (error) {
+    if (error == ba::error::eof && _parser.started() && _parser.finish()) {
+      // The body of the response was delimited by closing the connection.
+      _connection->processResponse(_parser.takeResponse());
+      _connection->restartConnection(this, ErrorCondition::CanceledDuringReset, Unanswered::Retry);
+      return;
+    }
+    FUERTE_LOG_CALLBACKS << "asyncReadCallback: Error while reading form socket: " << error.message() << std::endl;
+    // A connection that is closed before any byte of the response arrived
+    // is typically an idle keep-alive connection closed by the server.
+    _connection->restartConnection(this, ErrorCondition::HttpReadError,
+        _parser.started() ? Unanswered::Cancel : Unanswered::RetryIdempotent);
+    return;
+  }
+
+  FUERTE_LOG_CALLBACKS << "asyncReadCallback: received " << transferred << " bytes async-calls=" << pendingAsyncCalls << std::endl;
+
+  // Parse the data we've received so far, a single read may contain
+  // multiple (pipelined) responses.
+  auto receivedBuf = _receiveBuffer.data(); // no copy
+  auto cursor = ba::buffer_cast<const uint8_t*>(receivedBuf);
+  auto available = ba::buffer_size(receivedBuf);
+  try {
+    while (available > 0) {
+      if (!_parser.started()) {
+        _connection->resetParser(_parser);
+      }
+      auto consumed = _parser.feed(cursor, available);
+      _receiveBuffer.consume(consumed);
+      cursor += consumed;
+      available -= consumed;
+      if (!_parser.done()) {
+        break; // need more data
+      }
+
+      bool keepAlive = _parser.keepAlive();
+      _connection->processResponse(_parser.takeResponse());
+      _parser.reset(false);
+      if (!keepAlive) {
+        // The server does not process any further requests on this connection.
+        _connection->restartConnection(this, ErrorCondition::CanceledDuringReset, Unanswered::Retry);
+        return;
+      }
+      // Without pipelining the next request waits for this response.
+      _connection->startWriting();
+    }
+  } catch (std::exception const& ex) {
+    FUERTE_LOG_ERROR << "invalid HTTP response: " << ex.what() << std::endl;
+    _connection->restartConnection(this, ErrorCondition::HttpProtocolError, Unanswered::Cancel);
+    return;
+  }
+
+  // Continue reading data
+  readNextBytes();
+}
+
+// handler for deadline timer
+void HttpAsioConnection::ReadLoop::deadlineHandler(const BoostEC& error) {
+  if (!error) {
+    // Stop current connection and try to restart a new one.
+    _connection->restartConnection(this, ErrorCondition::Timeout, Unanswered::Cancel);
+  }
+}
+
+// ------------------------------------
+// Writing data
+// ------------------------------------
+
+// activate the sender loop (if needed)
+void HttpAsioConnection::startWriting() {
+  WriteLoop *newLoop;
+  {
+    std::lock_guard<std::mutex> lock(_writeLoop._mutex);
+    if (_writeLoop._current || !_connected) {
+      // There is already a write loop (or nothing to write to), do nothing
+      return;
+    }
+    // There is no current write loop, create one
+    _writeLoop._current = std::make_shared<WriteLoop>(
+        std::dynamic_pointer_cast<HttpAsioConnection>(shared_from_this()), _socket, _sslSocket);
+    newLoop = _writeLoop._current.get();
+  }
+  // Start the new loop
+  newLoop->start();
+}
+
+// Stop the current write loop
+void HttpAsioConnection::stopWriting() {
+  std::lock_guard<std::mutex> lock(_writeLoop._mutex);
+  _writeLoop._current.reset();
+}
+
+// called by a WriteLoop to request for the next request that will be written.
+// If there is no more work, nullptr is returned and the given loop must stop.
+HttpAsioConnection::RequestItemSP HttpAsioConnection::getNextRequestToSend(const WriteLoop* writeLoop) {
+  // Claim exclusive access
+  std::lock_guard<std::mutex> lock(_writeLoop._mutex);
+
+  // Is the write loop still the current write loop?
+  if (_writeLoop._current.get() != writeLoop) {
+    FUERTE_LOG_HTTPTRACE << "getNextRequestToSend: no longer current loop: loop=" << writeLoop << std::endl;
+    return RequestItemSP();
+  }
+
+  // Without pipelining only a single request may wait for its response.
+  // The ReadLoop restarts writing once that response arrived.
+  if (!_configuration._httpPipelining && !_inFlight.empty()) {
+    FUERTE_LOG_HTTPTRACE << "getNextRequestToSend: waiting for response" << std::endl;
+    _writeLoop._current.reset();
+    return RequestItemSP();
+  }
+
+  // Get next request from send queue.
+  auto next = _sendQueue.front();
+  if (!next) {
+    FUERTE_LOG_HTTPTRACE << "getNextRequestToSend: sendQueue empty" << std::endl;
+    _writeLoop._current.reset();
+    return RequestItemSP();
+  }
+
+  // Responses arrive in the order the requests are written.
+  _inFlight.add(next);
+  _sendQueue.removeFirst();
+
+  return next;
+}
+
+// Restart the connection if the given WriteLoop is still the current write loop.
+void HttpAsioConnection::restartConnection(const WriteLoop* writeLoop, const ErrorCondition error, const Unanswered unanswered) {
+  {
+    // Claim read & write loop mutex, so we can prevent that the ReadLoop & WriteLoop each restart
+    // the connection, resulting in a double restart.
+    std::unique_lock<std::mutex> readLoopLock(_readLoop._mutex, std::defer_lock);
+    std::unique_lock<std::mutex> writeLoopLock(_writeLoop._mutex, std::defer_lock);
+    std::lock(readLoopLock, writeLoopLock);
+    if (_writeLoop._current.get() != writeLoop) {
+      return;
+    }
+    _readLoop._current.reset();
+    _writeLoop._current.reset();
+  }
+  restartConnection(error, unanswered);
+}
+
+// start the write loop
+void HttpAsioConnection::WriteLoop::start() {
+  auto wasStarted = _started.exchange(true);
+  if (!wasStarted) {
+    sendNextRequest();
+  }
+}
+
+// writes the next request from the send queue using boost::asio::async_write
+void HttpAsioConnection::WriteLoop::sendNextRequest() {
+  // Get next request to send.
+  auto next = _connection->getNextRequestToSend(this);
+  if (!next) {
+    // No more work for me.
+    return;
+  }
+
+  // Make sure we're listening for the response
+  _connection->startReading();
+
+  // the request may be answered before a streamed body has been written
+  _timeout = next->_request->timeout();
+  writeRequestBuffers(std::move(next));
+}
+
+// writes the request buffers of the given item using boost::asio::async_write
+void HttpAsioConnection::WriteLoop::writeRequestBuffers(RequestItemSP item) {
+  // Set timeout
+  auto self = shared_from_this();
+  _deadline.expires_from_now(boost::posix_time::milliseconds(_timeout.count()));
+  _deadline.async_wait(boost::bind(&WriteLoop::deadlineHandler, self, _1));
+
+  _connection->_async_calls++;
+  auto handler = [this, self, item](BoostEC const& error, std::size_t transferred) {
+    asyncWriteCallback(error, transferred, item);
+  };
+  if (_sslSocket) {
+    ba::async_write(*_sslSocket, item->_requestBuffers, handler);
+  } else {
+    ba::async_write(*_socket, item->_requestBuffers, handler);
+  }
+}
+
+// callback of async_write function that is called in sendNextRequest.
+void HttpAsioConnection::WriteLoop::asyncWriteCallback(BoostEC const& error, std::size_t transferred, RequestItemSP item) {
+  // Cancel deadline
+  _deadline.cancel();
+
+  auto pendingAsyncCalls = --_connection->_async_calls;
+  if (error) {
+    // Send failed, most likely the server closed an idle keep-alive connection.
+    FUERTE_LOG_CALLBACKS << "asyncWriteCallback: error " << error.message() << std::endl;
+    _connection->restartConnection(this, ErrorCondition::HttpWriteError, Unanswered::RetryIdempotent);
+  } else {
+    // Send succeeded
+    FUERTE_LOG_CALLBACKS << "asyncWriteCallback: send succeeded, " << transferred << " bytes transferred async-calls=" << pendingAsyncCalls << std::endl;
+
+    // Write the rest of a streamed body first
+    bool bodyPending;
+    try {
+      bodyPending = item->nextBodyPart();
+    } catch (std::exception const& e) {
+      // part of the request is on the wire already
+      FUERTE_LOG_ERROR << "cannot read request body: " << e.what() << std::endl;
+      _connection->restartConnection(this, ErrorCondition::HttpWriteError, Unanswered::RetryIdempotent);
+      return;
+    }
+    if (bodyPending) {
+      writeRequestBuffers(std::move(item));
+      return;
+    }
+
+    // Continue with next request (if any)
+    sendNextRequest();
+  }
+}
+
+// handler for deadline timer
+void HttpAsioConnection::WriteLoop::deadlineHandler(const BoostEC& error) {
+  if (!error) {
+    // Stop current connection and try to restart a new one.
+    _connection->restartConnection(this, ErrorCondition::Timeout, Unanswered::Cancel);
+  }
+}
+
+}}}}
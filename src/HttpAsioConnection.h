@@ -0,0 +1,362 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#ifndef ARANGO_CXX_DRIVER_HTTP_ASIO_CONNECTION_H
+#define ARANGO_CXX_DRIVER_HTTP_ASIO_CONNECTION_H 1
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <deque>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/deadline_timer.hpp>
+
+#include <fuerte/connection.h>
+#include <fuerte/helper.h>
+#include <fuerte/loop.h>
+
+#include "CallOnceRequestCallback.h"
+#include "http.h"
+
+// naming in this file will be closer to asio for internal functions and types
+// functions that are exposed to other classes follow ArangoDB conding conventions
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace http {
+
+// HttpAsioConnection implements a client->server connection using HTTP/1.1
+// directly on an asio socket, without libcurl.
+//
+// It follows the structure of the VstConnection: a single persistent
+// (keep-alive) socket with a ReadLoop and a WriteLoop that stop when there is
+// no more work and are restarted on demand.
+//
+// Requests are written in the order they are sent. Without pipelining the
+// WriteLoop only writes the next request once the response of the previous
+// one has been read. With pipelining requests are written back to back and
+// the responses are matched to them in order.
+//
+// When the server closes the connection (e.g. "Connection: close" or an idle
+// keep-alive timeout) the connection is re-established on demand.
+class HttpAsioConnection : public Connection {
+ public:
+  explicit HttpAsioConnection(EventLoopService& eventLoopService, detail::ConnectionConfiguration const&);
+  virtual ~HttpAsioConnection();
+
+ public:
+  // Start an asynchronous request.
+  MessageID sendRequest(std::unique_ptr<Request>, RequestCallback) override;
+
+ private:
+  // Activate the connection.
+  virtual void start() override;
+  // Return the number of unfinished requests.
+  virtual std::size_t requestsLeft() override;
+
+ private:
+  // Item that represents a Request in flight
+  struct RequestItem {
+    std::unique_ptr<Request> _request;        // Reference to the request we're processing
+    impl::CallOnceRequestCallback _callback;  // Callback for when request is done (in error or succeeded)
+    MessageID _messageID;                     // ID of this message
+    std::string _requestHead;                 // request line & headers
+    std::vector<boost::asio::const_buffer> _requestBuffers; // Buffers the will be send to the socket.
+    unsigned _retries = 0;                    // Number of times this request was resent
+    // Streamed body (see Request::bodySource), the response may arrive before it is written
+    std::shared_ptr<RequestBodySource> _bodySource;
+    bool _bodyPending = false;                // Parts of the body still have to be written.
+    bool _bodyChunked = false;                // The body is written with chunked transfer encoding.
+    std::size_t _bodyRemaining = 0;           // Bytes of the body still to write (unless chunked).
+    std::string _bodyPart;                    // Part of the body that is being written.
+    std::string _bodyPartHead;                // Chunk size line of that part.
+
+    inline MessageID messageID() { return _messageID; }
+    inline bool isIdempotent() const {
+      // a body source can only be read once
+      return _request->header.restVerb.get() != RestVerb::Post &&
+             _request->header.restVerb.get() != RestVerb::Patch &&
+             !_request->bodySource();
+    }
+    // Point _requestBuffers at the request head (and the buffered body),
+    // so the request can be written (again).
+    void resetRequestBuffers();
+    // Read the next part of a streamed body into _requestBuffers.
+    // Returns false when the whole body has been written.
+    bool nextBodyPart();
+    inline void invokeOnError(Error e, std::unique_ptr<Request> req, std::unique_ptr<Response> res) {
+      _callback.invoke(e, std::move(req), std::move(res));
+    }
+  };
+  using RequestItemSP = std::shared_ptr<RequestItem>;
+
+  // What to do with requests that have been written but got no response when
+  // the connection is reset.
+  enum class Unanswered {
+    Cancel,           // fail them with the given error
+    RetryIdempotent,  // resend the idempotent ones (once), fail the others
+    Retry             // resend all of them except those with a body source (the server did not process them)
+  };
+
+  // SOCKET HANDLING /////////////////////////////////////////////////////////
+  void initSocket();
+  void shutdownSocket();
+  void shutdownConnection(const ErrorCondition = ErrorCondition::CanceledDuringReset,
+                          const Unanswered = Unanswered::Cancel);
+  void restartConnection(const ErrorCondition = ErrorCondition::CanceledDuringReset,
+                         const Unanswered = Unanswered::Cancel);
+
+  // resolve the host into a series of endpoints
+  void startResolveHost();
+
+  // establishes connection and initiates handshake
+  void startConnect(boost::asio::ip::tcp::resolver::iterator);
+  void asyncConnectCallback(boost::system::error_code const& ec, boost::asio::ip::tcp::resolver::iterator);
+
+  // start intiating an SSL connection (on top of an established TCP socket)
+  void startSSLHandshake();
+
+  // socket connection is up (with optional SSL), start sending requests.
+  void finishInitialization();
+  // connecting failed, fail all queued requests.
+  void failConnect(std::string const& message);
+
+  // createRequestItem prepares a RequestItem for the given parameters.
+  RequestItemSP createRequestItem(std::unique_ptr<Request> request, RequestCallback cb);
+
+  class ReadLoop;
+
+  // activate the receiver loop (if needed)
+  void startReading();
+  // release the ReadLoop so it will terminate.
+  void stopReading();
+  // called by a ReadLoop to decide if it must stop.
+  // returns true when the given loop should stop.
+  bool shouldStopReading(const ReadLoop*, std::chrono::milliseconds& timeout);
+  // Restart the connection if the given ReadLoop is still the current read loop.
+  void restartConnection(const ReadLoop*, const ErrorCondition, const Unanswered);
+
+  // Prepare the given parser for the response to the oldest request that waits
+  // for a response (HEAD requests, streamed responses).
+  void resetParser(ResponseParser& parser);
+  // Hand the given response to the oldest request that waits for a response.
+  void processResponse(std::unique_ptr<Response>);
+
+  class WriteLoop;
+
+  // activate the sending loop (if needed)
+  void startWriting();
+  // release the WriteLoop so it will terminate.
+  void stopWriting();
+  // called by a WriteLoop to request for the next request that will be written.
+  // If there is no more work, nullptr is returned and the given loop must stop.
+  RequestItemSP getNextRequestToSend(const WriteLoop*);
+  // Restart the connection if the given WriteLoop is still the current write loop.
+  void restartConnection(const WriteLoop*, const ErrorCondition, const Unanswered);
+
+ private:
+  std::atomic_uint_least64_t _messageID;
+  // "host:port" as sent in the Host header
+  const std::string _hostHeader;
+  // value of the Authorization header (empty for no authentication)
+  std::string _authorization;
+  // host resolving
+  std::shared_ptr<boost::asio::ip::tcp::resolver> _resolver;
+  // socket
+  const std::shared_ptr<::boost::asio::io_service> _ioService;
+  std::mutex _socket_mutex;
+  std::shared_ptr<::boost::asio::ip::tcp::socket> _socket;
+  boost::asio::ssl::context _context;
+  std::shared_ptr<::boost::asio::ssl::stream<::boost::asio::ip::tcp::socket&>> _sslSocket;
+  boost::asio::ip::tcp::resolver::iterator _endpoints;
+  std::atomic_bool _connecting;
+  std::atomic_bool _connected;
+  std::atomic<uint64_t> _async_calls;
+  struct {
+    std::mutex _mutex;
+    std::shared_ptr<ReadLoop> _current;
+  } _readLoop;
+  struct {
+    std::mutex _mutex;
+    std::shared_ptr<WriteLoop> _current;
+  } _writeLoop;
+
+  // RequestQueue encapsulates a thread safe FIFO of RequestItem's.
+  class RequestQueue {
+   public:
+    // add the given item to the end of the queue.
+    void add(RequestItemSP const& item) {
+      std::lock_guard<std::mutex> lockQueue(_mutex);
+      _queue.push_back(item);
+    }
+
+    // insert the given items in front of the queue (keeping their order).
+    void insert(std::deque<RequestItemSP> const& items) {
+      std::lock_guard<std::mutex> lockQueue(_mutex);
+      _queue.insert(_queue.begin(), items.begin(), items.end());
+    }
+
+    // front returns the first item in the queue.
+    // If the queue is empty, NULL is returned.
+    RequestItemSP front() {
+      std::lock_guard<std::mutex> lockQueue(_mutex);
+      if (_queue.empty()) {
+        return RequestItemSP();
+      }
+      return _queue.front();
+    }
+
+    // removeFirst removes the first entry of the queue and returns it.
+    RequestItemSP removeFirst() {
+      std::lock_guard<std::mutex> lockQueue(_mutex);
+      if (_queue.empty()) {
+        return RequestItemSP();
+      }
+      auto item = std::move(_queue.front());
+      _queue.pop_front();
+      return item;
+    }
+
+    // takeAll removes all items from the queue and returns them.
+    std::deque<RequestItemSP> takeAll() {
+      std::lock_guard<std::mutex> lockQueue(_mutex);
+      std::deque<RequestItemSP> items;
+      items.swap(_queue);
+      return items;
+    }
+
+    // size returns the number of elements in the queue.
+    std::size_t size() {
+      std::lock_guard<std::mutex> lockQueue(_mutex);
+      return _queue.size();
+    }
+
+    // empty returns true when there are no elements in the queue, false otherwise.
+    bool empty(bool unlocked = false) {
+      if (unlocked) {
+        return _queue.empty();
+      } else {
+        std::lock_guard<std::mutex> lockQueue(_mutex);
+        return _queue.empty();
+      }
+    }
+
+    // minimumTimeout returns the lowest timeout value of all requests in the queue.
+    // The queue must be locked by the caller.
+    std::chrono::milliseconds minimumTimeout() {
+      std::chrono::milliseconds min(2*60*1000); // If there is no request, use a timeout of 2 minutes.
+      for (auto& item : _queue) {
+        auto reqTimeout = item->_request->timeout();
+        if (reqTimeout.count() < min.count()) {
+          min = reqTimeout;
+        }
+      }
+      return min;
+    }
+
+    // mutex provides low level access to the mutex, used for shared locking.
+    std::mutex& mutex() { return _mutex; }
+
+   private:
+    std::mutex _mutex;
+    std::deque<RequestItemSP> _queue;
+  };
+  // requests that have not been written yet
+  RequestQueue _sendQueue;
+  // requests that have been written and wait for their response (in order)
+  RequestQueue _inFlight;
+
+  // Encapsulate a single read loop on a given socket for a given connection.
+  class ReadLoop : public std::enable_shared_from_this<ReadLoop> {
+   public:
+    ReadLoop(const std::shared_ptr<HttpAsioConnection>& connection,
+             const std::shared_ptr<::boost::asio::ip::tcp::socket>& socket,
+             const std::shared_ptr<::boost::asio::ssl::stream<::boost::asio::ip::tcp::socket&>>& sslSocket)
+      : _connection(connection), _socket(socket), _sslSocket(sslSocket),
+        _started(false), _deadline(*(connection->_ioService)) {
+      _parser.configureBody(connection->_configuration);
+    }
+    ~ReadLoop() {
+      _deadline.cancel();
+    }
+
+    // Start the read loop.
+    void start();
+
+   private:
+    // reads data from socket with boost::asio::async_read
+    void readNextBytes();
+    // handler for boost::asio::async_read that parses responses from the
+    // received data and starts a new read action.
+    void asyncReadCallback(boost::system::error_code const&, std::size_t transferred);
+    // handler for deadline timer
+    void deadlineHandler(const boost::system::error_code& error);
+
+   private:
+    std::shared_ptr<HttpAsioConnection> _connection;
+    std::shared_ptr<::boost::asio::ip::tcp::socket> _socket;
+    std::shared_ptr<::boost::asio::ssl::stream<::boost::asio::ip::tcp::socket&>> _sslSocket;
+    ::boost::asio::streambuf _receiveBuffer; // async read can not run concurrent
+    ResponseParser _parser;
+    std::atomic_bool _started;
+    ::boost::asio::deadline_timer _deadline;
+  };
+
+  // Encapsulate a single write loop on a given socket for a given connection.
+  class WriteLoop : public std::enable_shared_from_this<WriteLoop> {
+   public:
+    WriteLoop(const std::shared_ptr<HttpAsioConnection>& connection,
+              const std::shared_ptr<::boost::asio::ip::tcp::socket>& socket,
+              const std::shared_ptr<::boost::asio::ssl::stream<::boost::asio::ip::tcp::socket&>>& sslSocket)
+      : _connection(connection), _socket(socket), _sslSocket(sslSocket),
+        _started(false), _deadline(*(connection->_ioService)) {}
+    ~WriteLoop() {
+      _deadline.cancel();
+    }
+
+    // Start the write loop.
+    void start();
+
+   private:
+    // writes the next request from the send queue using boost::asio::async_write
+    void sendNextRequest();
+    // writes the request buffers of the given item using boost::asio::async_write
+    void writeRequestBuffers(RequestItemSP item);
+    // handler for boost::asio::async_write that calls sendNextRequest as long as there is new data
+    void asyncWriteCallback(boost::system::error_code const&, std::size_t transferred, RequestItemSP);
+    // handler for deadline timer
+    void deadlineHandler(const boost::system::error_code& error);
+
+   private:
+    std::shared_ptr<HttpAsioConnection> _connection;
+    std::shared_ptr<::boost::asio::ip::tcp::socket> _socket;
+    std::shared_ptr<::boost::asio::ssl::stream<::boost::asio::ip::tcp::socket&>> _sslSocket;
+    std::atomic_bool _started;
+    ::boost::asio::deadline_timer _deadline;
+    std::chrono::milliseconds _timeout;  // timeout of the request that is being written
+  };
+};
+
+}}}}
+#endif
@@ -35,6 +35,9 @@
 #include <fuerte/types.h>
 #include <fuerte/loop.h>
 
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
 namespace arangodb {
 namespace fuerte {
 inline namespace v1 {
@@ -43,9 +46,12 @@ namespace http {
 using namespace arangodb::fuerte::detail;
 
 HttpConnection::HttpConnection(EventLoopService& eventLoopService, ConnectionConfiguration const& configuration)
-    : Connection(eventLoopService, configuration) {
+    : Connection(eventLoopService, configuration),
+      _baseUrl((configuration._ssl ? "https://" : "http://") + configuration._host
+               + ":" + configuration._port) {
   _curlm.reset(new CurlMultiAsio(
-      *eventLoopService.io_service(), 
+      *eventLoopService.io_service(), configuration,
+        configuration._shareHttpCaches ? eventLoopService.curlShare() : nullptr,
         boost::bind(&HttpConnection::handleResult, this, _1, _2)));
 }
 
@@ -62,25 +68,45 @@ HttpConnection::~HttpConnection() {
 }
 
 MessageID HttpConnection::sendRequest(std::unique_ptr<Request> request, RequestCallback callback) {
-  std::string dbString = (request->header.database) ? std::string("/_db/") + request->header.database.get() : std::string("");
-  Destination destination = (_configuration._ssl ? "https://" : "http://")
-                          + _configuration._host
-                          + ":"
-                          + _configuration._port
-                          + dbString
-                          + request->header.path.get();
+  auto const& header = request->header;
+  auto const& parameters = header.parameters;
 
-  auto const& parameters = request->header.parameters;
+  // build the URL in a single pass, sized for the common case
+  size_t size = _baseUrl.size();
+  if (header.database) {
+    size += 5 + header.database.get().size();
+  }
+  if (header.path) {
+    size += header.path.get().size();
+  }
+  if (parameters) {
+    for (auto const& p : parameters.get()) {
+      size += p.first.size() + p.second.size() + 2;
+    }
+  }
 
-  if (parameters && !parameters.get().empty()) {
-    std::string sep = "?";
+  Destination destination;
+  destination.reserve(size + 8);
+  destination.append(_baseUrl);
+  if (header.database) {
+    destination.append("/_db/");
+    appendSafeDotted(destination, header.database.get());
+  }
+  if (header.path) {
+    appendSafeDotted(destination, header.path.get());
+  }
 
-    for (auto p : parameters.get()) {
-      destination += sep + urlEncode(p.first) + "=" + urlEncode(p.second);
-      sep = "&";
+  if (parameters && !parameters.get().empty()) {
+    char sep = '?';
+    for (auto const& p : parameters.get()) {
+      destination.push_back(sep);
+      urlEncode(destination, p.first);
+      destination.push_back('=');
+      urlEncode(destination, p.second);
+      sep = '&';
     }
   }
-  return queueRequest(destination, std::move(request), callback);
+  return queueRequest(std::move(destination), std::move(request), callback);
 }
 
 // -----------------------------------------------------------------------------
@@ -96,7 +122,7 @@ uint64_t HttpConnection::queueRequest(Destination destination,
   // Prepare a new request
   auto id = ++ticketId;
   request->messageID = id;
-  createRequestItem(destination, std::move(request), callback);
+  createRequestItem(std::move(destination), std::move(request), callback);
 
   return id;
 }
@@ -179,15 +205,25 @@ size_t HttpConnection::readHeaders(char* buffer, size_t size, size_t nitems,
   size_t realsize = size * nitems;
   RequestItem* rip = (struct RequestItem*)userptr;
 
-  std::string const header(buffer, realsize);
-  size_t pivot = header.find_first_of(':');
-
-  if (pivot != std::string::npos) {
-    std::string key(header.c_str(), pivot);
-    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-
-    rip->_responseHeaders.emplace(
-        key, header.substr(pivot + 2, header.length() - pivot - 4));
+  boost::string_ref const header(buffer, realsize);
+  size_t pivot = header.find(':');
+
+  if (pivot != boost::string_ref::npos && realsize >= pivot + 4) {
+    // "key: value\r\n"
+    boost::string_ref key(buffer, pivot);
+    boost::string_ref value(buffer + pivot + 2, realsize - pivot - 4);
+
+    if (rip->_responseHeaders.emplace(key, value) && boost::iequals(key, "content-length") &&
+        !rip->_request->responseDataCallback()) {
+      // size the body buffer up front, so readBody rarely has to grow it
+      // (the reservation is capped, see SpillBuffer::reserve)
+      try {
+        auto length = std::stoull(value.to_string());
+        rip->_responseBody.reserve(length);
+      } catch (std::exception const&) {
+        // ignore, the buffer will grow as needed
+      }
+    }
   }
   return realsize;
 }
@@ -199,81 +235,110 @@ size_t HttpConnection::readBody(void* data, size_t size, size_t nitems,
   RequestItem* rip = (struct RequestItem*)userp;
 
   try {
-    rip->_responseBody.append((char*)data, realsize);
+    auto const& dataCallback = rip->_request->responseDataCallback();
+    if (dataCallback) {
+      // streamed response, pass the body on instead of buffering it
+      long httpStatusCode = 0;
+      curl_easy_getinfo(rip->handle(), CURLINFO_RESPONSE_CODE, &httpStatusCode);
+      dataCallback(static_cast<StatusCode>(httpStatusCode),
+                   (uint8_t const*)data, realsize);
+      return realsize;
+    }
+    rip->_responseBody.append((uint8_t const*)data, realsize);
     return realsize;
-  } catch (std::bad_alloc&) {
+  } catch (std::exception const&) {
+    // returning less than realsize aborts the transfer
     return 0;
   }
 }
 
-void HttpConnection::transformResult(CURL* handle, StringMap&& responseHeaders,
-                                       std::string const& responseBody,
+// pulls the body of the request from its body source (CURLOPT_READFUNCTION)
+size_t HttpConnection::readRequestBody(char* buffer, size_t size, size_t nitems,
+                                       void* userdata) {
+  RequestItem* rip = (struct RequestItem*)userdata;
+
+  try {
+    return rip->_request->bodySource()->read(reinterpret_cast<uint8_t*>(buffer), size * nitems);
+  } catch (std::exception const& e) {
+    FUERTE_LOG_ERROR << "cannot read request body: " << e.what() << std::endl;
+    return CURL_READFUNC_ABORT;
+  }
+}
+
+void HttpConnection::transformResult(CURL* handle, HeaderMap&& responseHeaders,
+                                       SpillBuffer& responseBody,
                                        Response* response) {
 #if  ENABLE_FUERTE_LOG_HTTPTRACE > 0
   std::cout << "header START" << std::endl;
-  for(auto& p : responseHeaders){
+  for(auto const& p : responseHeaders){
     std::cout << p.first << "  " <<p.second << std::endl;
   }
   std::cout << "header END" << std::endl;
 #endif
 
   // no available - response->header.requestType
-  auto const& ctype = responseHeaders[fu_content_type_key];
-  response->header.contentType(ctype);
-
-  if (responseBody.length()) {
-      VBuffer buffer;
-      buffer.append(responseBody);
-      response->setPayload(std::move(buffer), 0);
+  // the content type is taken from the headers by the HeaderMap itself
+  if (responseBody.size()) {
+      responseBody.moveTo(*response, 0);
   }
   response->header.meta = std::move(responseHeaders);
 
 }
 
-std::string HttpConnection::createSafeDottedCurlUrl(
-    std::string const& originalUrl) {
-  std::string url;
-  url.reserve(originalUrl.length());
-
-  size_t length = originalUrl.length();
-  size_t currentFind = 0;
-  std::size_t found;
-  std::vector<char> urlDotSeparators{'/', '#', '?'};
-
-  while ((found = originalUrl.find("/.", currentFind)) != std::string::npos) {
-    if (found + 2 == length) {
-      url += originalUrl.substr(currentFind, found - currentFind) + "/%2E";
-    } else if (std::find(urlDotSeparators.begin(), urlDotSeparators.end(),
-                         originalUrl.at(found + 2)) != urlDotSeparators.end()) {
-      url += originalUrl.substr(currentFind, found - currentFind) + "/%2E";
+void HttpConnection::appendSafeDotted(std::string& out, std::string const& part) {
+  char const* p = part.data();
+  char const* end = p + part.size();
+
+  while (p < end) {
+    char const* found = p;
+    while (found < end && !(found[0] == '/' && found + 1 < end && found[1] == '.')) {
+      ++found;
+    }
+    out.append(p, found - p);
+    if (found == end) {
+      break;
+    }
+    // a "." that forms a complete path segment must be escaped
+    char const* next = found + 2;
+    if (next == end || *next == '/' || *next == '#' || *next == '?') {
+      out.append("/%2E");
     } else {
-      url += originalUrl.substr(currentFind, found - currentFind) + "/.";
+      out.append("/.");
     }
-    currentFind = found + 2;
+    p = next;
   }
-  url += originalUrl.substr(currentFind);
-  return url;
 }
 
-void HttpConnection::createRequestItem(const Destination& destination, std::unique_ptr<Request> request, RequestCallback callback) {
+void HttpConnection::createRequestItem(Destination&& destination, std::unique_ptr<Request> request, RequestCallback callback) {
   // mop: the curl handle will be managed safely via unique_ptr and hold
   // ownership for rip
-  auto requestItem = std::make_shared<RequestItem>(destination, std::move(request), callback);
+  auto requestItem = std::make_shared<RequestItem>(std::move(destination), std::move(request), callback);
+  requestItem->_responseBody.configure(_configuration);
   auto handle = requestItem->handle();
   struct curl_slist* requestHeaders = nullptr;
   auto fuRequest = requestItem->_request.get();
-  if (fuRequest->header.meta) {
-    for (auto const& header : fuRequest->header.meta.get()) {
-      std::string thisHeader(header.first + ": " + header.second);
-      requestHeaders = curl_slist_append(requestHeaders, thisHeader.c_str());
+  std::string thisHeader;
+  for (auto const& header : fuRequest->header.meta) {
+    thisHeader.assign(header.first.data(), header.first.size());
+    thisHeader.append(": ");
+    thisHeader.append(header.second.data(), header.second.size());
+    requestHeaders = curl_slist_append(requestHeaders, thisHeader.c_str());
+  }
+
+  auto const& bodySource = fuRequest->bodySource();
+  if (bodySource) {
+    // the body is sent as it is read, without waiting for 100-continue
+    requestHeaders = curl_slist_append(requestHeaders, "Expect:");
+    if (!bodySource->size() && _configuration._httpVersion != http::HTTP2) {
+      // HTTP/2 has no chunked transfer encoding, the frames delimit the body
+      requestHeaders = curl_slist_append(requestHeaders, "Transfer-Encoding: chunked");
     }
   }
 
-  std::string url = createSafeDottedCurlUrl(requestItem->_destination);
   requestItem->_requestHeaders = requestHeaders;
   curl_easy_setopt(handle, CURLOPT_HTTPHEADER, requestHeaders);
   curl_easy_setopt(handle, CURLOPT_HEADER, 0L);
-  curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(handle, CURLOPT_URL, requestItem->_destination.c_str());
   curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, HttpConnection::readBody);
   curl_easy_setopt(handle, CURLOPT_WRITEDATA, requestItem.get());
   curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, &HttpConnection::readHeaders);
@@ -285,6 +350,16 @@ void HttpConnection::createRequestItem(const Destination& destination, std::uniq
 #endif
   curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, requestItem->_errorBuffer);
 
+  if (_configuration._httpVersion == http::HTTP2) {
+    // cleartext connections cannot negotiate HTTP/2 (no ALPN), so we talk
+    // HTTP/2 right away. TLS connections negotiate it during the handshake.
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION,
+                     _configuration._ssl ? CURL_HTTP_VERSION_2TLS
+                                         : CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+    // rather wait for a connection that can be multiplexed than open a new one
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+  }
+
   // mop: XXX :S CURLE 51 and 60...
   curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 0L);
   curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 0L);
@@ -360,17 +435,30 @@ void HttpConnection::createRequestItem(const Destination& destination, std::uniq
       break;
   }
 
-  std::string empty("");
-  std::string& body = empty;
-
   auto pay = fuRequest->payload();
   auto paySize = boost::asio::buffer_size(pay);
 
-  if (paySize > 0) {
-    // https://curl.haxx.se/libcurl/c/CURLOPT_COPYPOSTFIELDS.html
+  if (bodySource) {
+    // curl pulls the body from the source while sending it. CURLOPT_UPLOAD
+    // makes curl send a body with any method, the custom request sets the
+    // method of the request (instead of PUT).
+    auto method = boost::algorithm::to_upper_copy(to_string(verb));
+    curl_easy_setopt(handle, CURLOPT_UPLOAD, 1L);
+    curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, method.c_str());
+    curl_easy_setopt(handle, CURLOPT_READFUNCTION, &HttpConnection::readRequestBody);
+    curl_easy_setopt(handle, CURLOPT_READDATA, requestItem.get());
+    if (bodySource->size()) {
+      curl_easy_setopt(handle, CURLOPT_INFILESIZE_LARGE,
+                       static_cast<curl_off_t>(bodySource->size().get()));
+    }
+  } else if (paySize > 0) {
+    // https://curl.haxx.se/libcurl/c/CURLOPT_POSTFIELDS.html
+    // curl sends straight out of the request payload, it does not copy it.
+    // The request is owned by the RequestItem until handleResult is done with
+    // the easy handle, so the buffer outlives the transfer.
     // DO NOT CHANGE BODY SIZE LATER!!
-    curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE, paySize);
-    curl_easy_setopt(handle, CURLOPT_COPYPOSTFIELDS, boost::asio::buffer_cast<const char*>(pay));
+    curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(paySize));
+    curl_easy_setopt(handle, CURLOPT_POSTFIELDS, boost::asio::buffer_cast<const char*>(pay));
   }
 
   requestItem->_startTime = std::chrono::steady_clock::now();
@@ -412,7 +500,7 @@ void HttpConnection::handleResult(CURL* handle, CURLcode rc) {
         fuResponse->header.responseCode = static_cast<unsigned>(httpStatusCode);
         fuResponse->messageID = requestItem->_request->messageID;
         transformResult(handle, std::move(requestItem->_responseHeaders),
-                        std::move(requestItem->_responseBody),
+                        requestItem->_responseBody,
                         dynamic_cast<Response*>(fuResponse.get()));
 
         auto response_id = fuResponse->messageID;
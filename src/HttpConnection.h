@@ -38,6 +38,8 @@
 #include <fuerte/types.h>
 #include <fuerte/FuerteLogger.h>
 
+#include "SpillBuffer.h"
+
 #include <curl/curl.h>
 
 #include "CallOnceRequestCallback.h"
@@ -78,8 +80,8 @@ class HttpConnection : public Connection {
   // RequestItem contains all data of a single request that is ongoing.
   class RequestItem {
    public:
-    RequestItem(const Destination& destination, std::unique_ptr<Request> request, RequestCallback callback)
-        : _destination(destination),
+    RequestItem(Destination&& destination, std::unique_ptr<Request> request, RequestCallback callback)
+        : _destination(std::move(destination)),
           _request(std::move(request)),
           _callback(callback),
           _requestHeaders(nullptr),
@@ -126,9 +128,9 @@ class HttpConnection : public Connection {
     std::string _requestBody;
     struct curl_slist* _requestHeaders;
 
-    StringMap _responseHeaders;
+    HeaderMap _responseHeaders;
     std::chrono::steady_clock::time_point _startTime;
-    std::string _responseBody;
+    SpillBuffer _responseBody;  // moved into the Response once the transfer is done
 
     char _errorBuffer[CURL_ERROR_SIZE];
    private:
@@ -139,6 +141,8 @@ class HttpConnection : public Connection {
 
  private:
   static size_t readBody(void*, size_t, size_t, void*);
+  static size_t readRequestBody(char* buffer, size_t size, size_t nitems,
+                                void* userdata);
   static size_t readHeaders(char* buffer, size_t size, size_t nitems,
                             void* userdata);
   static int curlDebug(CURL*, curl_infotype, char*, size_t, void*);
@@ -146,16 +150,18 @@ class HttpConnection : public Connection {
   static void logHttpBody(std::string const&, std::string const&);
 
  private:
-  void createRequestItem(const Destination& destination, std::unique_ptr<Request> request, RequestCallback callback);
+  void createRequestItem(Destination&& destination, std::unique_ptr<Request> request, RequestCallback callback);
   void handleResult(CURL*, CURLcode);
-  void transformResult(CURL*, StringMap&&, std::string const&, Response*);
+  void transformResult(CURL*, HeaderMap&&, SpillBuffer&, Response*);
 
   /// @brief curl will strip standalone ".". ArangoDB allows using . as a key
-  /// so this thing will analyse the url and urlencode any unsafe .'s
-  std::string createSafeDottedCurlUrl(std::string const& originalUrl);
+  /// so this appends the given url part and urlencodes any unsafe .'s
+  static void appendSafeDotted(std::string& out, std::string const& part);
 
  private:
   std::shared_ptr<CurlMultiAsio> _curlm;
+  // scheme, host and port of all request URLs, computed once
+  std::string const _baseUrl;
   //int _stillRunning;
 };
 
@@ -0,0 +1,175 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cctype>
+
+#include "QueryCache.h"
+#include "xxhash.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace impl {
+
+QueryCache::QueryCache(QueryCacheOptions const& options)
+  : _options(options)
+  , _bytes(0)
+  , _epoch(0)
+  {}
+
+std::string QueryCache::key(std::string const& query, VSlice const& bindVars) {
+  std::string normalized;
+  normalized.reserve(query.size());
+  char quote = 0;
+  bool escaped = false;
+  bool blank = false;
+  for (std::size_t i = 0; i < query.size(); i++) {
+    char c = query[i];
+    if (quote != 0) {
+      normalized.push_back(c);
+      if (escaped) {
+        escaped = false;
+      } else if (c == '\\') {
+        escaped = true;
+      } else if (c == quote) {
+        quote = 0;
+      }
+      continue;
+    }
+    if (c == '/' && i + 1 < query.size() && (query[i + 1] == '/' || query[i + 1] == '*')) {
+      // comments are dropped, they separate tokens like white space.
+      // A line comment ends at the line break, a block comment after "*/".
+      bool line = query[i + 1] == '/';
+      auto end = line ? query.find('\n', i + 2) : query.find("*/", i + 2);
+      i = end == std::string::npos ? query.size() : (line ? end : end + 1);
+      blank = true;
+      continue;
+    }
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      blank = true;
+      continue;
+    }
+    if (blank && !normalized.empty()) {
+      normalized.push_back(' ');
+    }
+    blank = false;
+    if (c == '\'' || c == '"' || c == '`') {
+      quote = c;
+    }
+    normalized.push_back(c);
+  }
+  normalized.push_back('\0');
+  if (!bindVars.isNone()) {
+    normalized.append(reinterpret_cast<char const*>(bindVars.start()), bindVars.byteSize());
+  }
+  return normalized;
+}
+
+uint64_t QueryCache::hash(std::string const& key) {
+  return XXH64(key.data(), key.size(), 0xdeadbeef);
+}
+
+std::shared_ptr<VBuffer const> QueryCache::find(std::string const& key) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = _index.find(hash(key));
+  if (it == _index.end() || it->second->key != key) {
+    // unknown, or another query with the same hash
+    return nullptr;
+  }
+  if (it->second->expires <= std::chrono::steady_clock::now()) {
+    remove(it->second);
+    return nullptr;
+  }
+  _entries.splice(_entries.begin(), _entries, it->second);
+  return it->second->result;
+}
+
+uint64_t QueryCache::epoch() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _epoch;
+}
+
+void QueryCache::store(std::string const& key, std::shared_ptr<VBuffer const> result,
+                       std::vector<std::string> const& collections, uint64_t epoch) {
+  uint64_t hash = QueryCache::hash(key);
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (epoch != _epoch || result->size() > _options.maxBytes) {
+    return;
+  }
+  auto it = _index.find(hash);
+  if (it != _index.end()) {
+    // replaces the result of this or of another query with the same hash
+    remove(it->second);
+  }
+  while (!_entries.empty() && _bytes + result->size() > _options.maxBytes) {
+    // evict the least recently used result
+    remove(std::prev(_entries.end()));
+  }
+
+  _bytes += result->size();
+  _entries.push_front(Entry{hash, key, std::move(result), collections,
+                            std::chrono::steady_clock::now() + _options.ttl});
+  _index.emplace(hash, _entries.begin());
+  for (auto const& collection : collections) {
+    _collections[collection].insert(hash);
+  }
+}
+
+void QueryCache::invalidate(std::string const& collection) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _epoch++;
+  auto it = _collections.find(collection);
+  if (it == _collections.end()) {
+    return;
+  }
+  auto hashes = std::move(it->second);
+  _collections.erase(it);
+  for (auto hash : hashes) {
+    auto entry = _index.find(hash);
+    if (entry != _index.end()) {
+      remove(entry->second);
+    }
+  }
+}
+
+void QueryCache::clear() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _epoch++;
+  _entries.clear();
+  _index.clear();
+  _collections.clear();
+  _bytes = 0;
+}
+
+void QueryCache::remove(std::list<Entry>::iterator entry) {
+  for (auto const& collection : entry->collections) {
+    auto it = _collections.find(collection);
+    if (it != _collections.end()) {
+      it->second.erase(entry->hash);
+      if (it->second.empty()) {
+        _collections.erase(it);
+      }
+    }
+  }
+  _bytes -= entry->result->size();
+  _index.erase(entry->hash);
+  _entries.erase(entry);
+}
+
+}}}}
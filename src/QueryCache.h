@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#ifndef ARANGO_CXX_DRIVER_QUERY_CACHE_H
+#define ARANGO_CXX_DRIVER_QUERY_CACHE_H 1
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fuerte/database.h>
+#include <fuerte/types.h>
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace impl {
+
+// QueryCache keeps the results of AQL queries, keyed by the normalized query
+// text and the velocypack bytes of the bind parameters. Entries are found by
+// the hash of the key, the key itself is compared on every hit.
+// Entries expire after the configured TTL. When the results exceed the
+// budget of bytes, the least recently used ones are evicted.
+// Every entry is tagged with the collections its query reads, so writes to
+// a collection can drop the results that depend on it.
+class QueryCache {
+ public:
+  QueryCache(QueryCacheOptions const& options);
+
+  // Prevent copying
+  QueryCache(QueryCache const& other) = delete;
+  QueryCache& operator=(QueryCache const& other) = delete;
+
+  // key returns the key of a query. Comments and runs of white space outside
+  // of string literals are treated like a single blank.
+  static std::string key(std::string const& query, VSlice const& bindVars);
+
+  // find returns the result of the query with the given key, or nullptr.
+  std::shared_ptr<VBuffer const> find(std::string const& key);
+  // epoch returns a value that changes whenever results are invalidated.
+  // Results of queries started before the epoch changed are not stored.
+  uint64_t epoch();
+  // store keeps the result of a query that started with the given epoch.
+  void store(std::string const& key, std::shared_ptr<VBuffer const> result,
+             std::vector<std::string> const& collections, uint64_t epoch);
+  // invalidate drops the results of queries that read the given collection.
+  void invalidate(std::string const& collection);
+  // clear drops all results.
+  void clear();
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    std::string key;
+    std::shared_ptr<VBuffer const> result;
+    std::vector<std::string> collections;
+    std::chrono::steady_clock::time_point expires;
+  };
+
+  // hash returns the hash of the given key.
+  static uint64_t hash(std::string const& key);
+  // remove drops the given entry. Must be called with _mutex held.
+  void remove(std::list<Entry>::iterator entry);
+
+ private:
+  QueryCacheOptions _options;
+
+  std::mutex _mutex;
+  std::list<Entry> _entries; // most recently used first
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> _index;
+  std::unordered_map<std::string, std::unordered_set<uint64_t>> _collections;
+  std::size_t _bytes;
+  uint64_t _epoch;
+};
+
+}}}}
+#endif
@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "SingleFlightConnection.h"
+
+#include <fuerte/helper.h>
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace impl {
+
+SingleFlightConnection::SingleFlightConnection(std::shared_ptr<Connection> connection,
+                                               EventLoopService& eventLoopService,
+                                               detail::ConnectionConfiguration const& conf)
+  : Connection(eventLoopService, conf)
+  , _connection(std::move(connection))
+  , _flights(std::make_shared<Flights>())
+  {}
+
+MessageID SingleFlightConnection::sendRequest(std::unique_ptr<Request> request, RequestCallback cb) {
+  auto key = requestIdentity(*request);
+  if (key.empty()) {
+    return _connection->sendRequest(std::move(request), std::move(cb));
+  }
+
+  auto flight = std::make_shared<Flight>();
+  {
+    std::lock_guard<std::mutex> lock(_flights->mutex);
+    auto it = _flights->flights.find(key);
+    if (it != _flights->flights.end()) {
+      // attach to the request in flight
+      it->second->followers.emplace_back(std::move(request), std::move(cb));
+      _flights->followers++;
+      return it->second->messageID;
+    }
+    _flights->flights.emplace(key, flight);
+  }
+
+  auto flights = _flights;
+  MessageID messageID;
+  try {
+    messageID = _connection->sendRequest(std::move(request),
+        [flights, flight, key, cb](Error error, std::unique_ptr<Request> request, std::unique_ptr<Response> response) {
+      // requests sent from now on start a new flight
+      land(*flights, key, flight);
+      for (auto& follower : flight->followers) {
+        follower.second(error, std::move(follower.first), response ? copyResponse(*response) : nullptr);
+      }
+      cb(error, std::move(request), std::move(response));
+    });
+  } catch (...) {
+    land(*_flights, key, flight);
+    for (auto& follower : flight->followers) {
+      follower.second(errorToInt(ErrorCondition::ConnectionError), std::move(follower.first), nullptr);
+    }
+    throw;
+  }
+
+  std::lock_guard<std::mutex> lock(_flights->mutex);
+  flight->messageID = messageID;
+  return messageID;
+}
+
+std::size_t SingleFlightConnection::requestsLeft() {
+  std::lock_guard<std::mutex> lock(_flights->mutex);
+  return _connection->requestsLeft() + _flights->followers;
+}
+
+void SingleFlightConnection::land(Flights& flights, std::string const& key,
+                                  std::shared_ptr<Flight> const& flight) {
+  std::lock_guard<std::mutex> lock(flights.mutex);
+  auto it = flights.flights.find(key);
+  if (it != flights.flights.end() && it->second == flight) {
+    flights.flights.erase(it);
+    flights.followers -= flight->followers.size();
+  }
+}
+
+}}}}
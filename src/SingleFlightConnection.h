@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef ARANGO_CXX_DRIVER_SINGLE_FLIGHT_CONNECTION_H
+#define ARANGO_CXX_DRIVER_SINGLE_FLIGHT_CONNECTION_H 1
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fuerte/connection.h>
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace impl {
+
+// SingleFlightConnection sends requests through another connection.
+// A GET or HEAD request without body that equals a request which is still
+// in flight (verb, database, path, parameters, meta & credentials) is not
+// sent again, it gets a copy of the response of the request in flight.
+// See ConnectionBuilder::singleFlight.
+class SingleFlightConnection : public Connection {
+ public:
+  SingleFlightConnection(std::shared_ptr<Connection> connection,
+                         EventLoopService& eventLoopService,
+                         detail::ConnectionConfiguration const& conf);
+
+  // Start an asynchronous request.
+  MessageID sendRequest(std::unique_ptr<Request>, RequestCallback) override;
+  // Return the number of unfinished requests.
+  std::size_t requestsLeft() override;
+
+ private:
+  // Requests waiting for the response of the request in flight.
+  struct Flight {
+    Flight() : messageID(0) {}
+
+    MessageID messageID; // of the request in flight
+    std::vector<std::pair<std::unique_ptr<Request>, RequestCallback>> followers;
+  };
+
+  // Flights are shared with the callbacks, which may outlive the connection.
+  struct Flights {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> flights;
+    std::size_t followers = 0;
+  };
+
+  // land removes the given flight, no requests attach to it afterwards.
+  static void land(Flights& flights, std::string const& key,
+                   std::shared_ptr<Flight> const& flight);
+
+ private:
+  std::shared_ptr<Connection> _connection;
+  std::shared_ptr<Flights> _flights;
+};
+
+}}}}
+#endif
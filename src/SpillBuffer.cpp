@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "SpillBuffer.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 {
+
+// Data for the temporary file is collected up to this size before it is written.
+static std::size_t const spillWriteSize = 1024 * 1024;
+// Memory reserved up front for an announced length is capped at this size,
+// the announced length comes from the server and is not trusted.
+static std::size_t const maxReserveSize = 16 * 1024 * 1024;
+
+SpillBuffer::SpillBuffer() : _threshold(0), _fd(-1), _size(0) {}
+
+SpillBuffer::~SpillBuffer() {
+  if (_fd >= 0) {
+    ::close(_fd);
+  }
+}
+
+void SpillBuffer::configure(std::size_t threshold, std::string const& directory) {
+  _threshold = threshold;
+  _directory = directory;
+}
+
+void SpillBuffer::reserve(std::size_t length) {
+  if (spilled()) {
+    return;
+  }
+  if (_threshold > 0 && length > _threshold) {
+    spill();
+    return;
+  }
+  // larger content grows the buffer as it arrives
+  _buffer.reserve(std::min(length, maxReserveSize));
+}
+
+void SpillBuffer::append(uint8_t const* data, std::size_t length) {
+  if (_file) {
+    throw std::logic_error("cannot append to a mapped buffer");
+  }
+  if (_fd < 0 && _threshold > 0 && _size + length > _threshold) {
+    spill();
+  }
+  _buffer.append(data, length);
+  _size += length;
+  if (_fd >= 0 && _buffer.byteSize() >= spillWriteSize) {
+    flush();
+  }
+}
+
+uint8_t const* SpillBuffer::data() {
+  if (!spilled()) {
+    return _buffer.data();
+  }
+  if (!_file) {
+    flush();
+    _file = std::make_shared<MappedFile>(_fd, 0, _size);
+    // the mapping keeps the (unlinked) file alive
+    ::close(_fd);
+    _fd = -1;
+  }
+  return _file->data();
+}
+
+void SpillBuffer::moveTo(Response& response, std::size_t offset) {
+  if (spilled()) {
+    data();
+    response.setPayload(std::move(_file), offset);
+  } else {
+    response.setPayload(std::move(_buffer), offset);
+  }
+  clear();
+}
+
+void SpillBuffer::clear() {
+  if (_fd >= 0) {
+    ::close(_fd);
+    _fd = -1;
+  }
+  _file.reset();
+  _buffer.clear();
+  _size = 0;
+}
+
+void SpillBuffer::swap(SpillBuffer& other) {
+  std::swap(_buffer, other._buffer);
+  std::swap(_fd, other._fd);
+  std::swap(_size, other._size);
+  std::swap(_file, other._file);
+}
+
+// spill creates the temporary file and writes the content collected so far.
+void SpillBuffer::spill() {
+  std::string directory = _directory;
+  if (directory.empty()) {
+    char const* tmp = std::getenv("TMPDIR");
+    directory = (tmp != nullptr && *tmp != '\0') ? tmp : "/tmp";
+  }
+  std::string pattern = directory + "/fuerte-response-XXXXXX";
+  std::vector<char> path(pattern.begin(), pattern.end());
+  path.push_back('\0');
+
+  _fd = ::mkstemp(path.data());
+  if (_fd < 0) {
+    throw std::runtime_error("cannot create temporary file in '" + directory +
+                             "': " + std::strerror(errno));
+  }
+  // the file is removed as soon as it is no longer open or mapped
+  ::unlink(path.data());
+  flush();
+  // release the memory held so far
+  _buffer.clear();
+}
+
+// flush writes the collected data to the temporary file.
+void SpillBuffer::flush() {
+  uint8_t const* cursor = _buffer.data();
+  std::size_t length = _buffer.byteSize();
+  while (length > 0) {
+    auto n = ::write(_fd, cursor, length);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(std::string("cannot write temporary file: ") +
+                               std::strerror(errno));
+    }
+    cursor += n;
+    length -= static_cast<std::size_t>(n);
+  }
+  _buffer.resetTo(0);
+}
+
+}}}
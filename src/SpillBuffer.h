@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#ifndef ARANGO_CXX_DRIVER_SPILL_BUFFER_H
+#define ARANGO_CXX_DRIVER_SPILL_BUFFER_H 1
+
+#include <memory>
+#include <string>
+
+#include <fuerte/message.h>
+#include <fuerte/types.h>
+
+namespace arangodb { namespace fuerte { inline namespace v1 {
+
+// SpillBuffer collects the payload of a response. Once the payload grows
+// beyond the configured threshold it is moved to an unlinked temporary file,
+// which is mapped into memory when the payload is complete. This bounds the
+// heap memory used for large responses.
+class SpillBuffer {
+ public:
+  SpillBuffer();
+  ~SpillBuffer();
+
+  // Prevent copying
+  SpillBuffer(SpillBuffer const& other) = delete;
+  SpillBuffer& operator=(SpillBuffer const& other) = delete;
+
+  // configure sets the size above which the content is written to a file
+  // in the given directory (0 = never, empty directory = $TMPDIR or /tmp).
+  void configure(std::size_t threshold, std::string const& directory);
+  void configure(detail::ConnectionConfiguration const& configuration) {
+    configure(configuration._responseSpillThreshold,
+              configuration._responseSpillDirectory);
+  }
+
+  // reserve announces the final size of the content, a content that will
+  // not fit below the threshold is written to a file right away. At most
+  // 16MB are reserved in memory, the buffer grows beyond that as needed.
+  void reserve(std::size_t length);
+  // append adds data to the content.
+  // Throws when the temporary file cannot be written.
+  void append(uint8_t const* data, std::size_t length);
+
+  std::size_t size() const { return _size; }
+  bool spilled() const { return _fd >= 0 || _file; }
+
+  // data returns the content. Content that was written to a file is mapped
+  // into memory, nothing can be appended afterwards.
+  uint8_t const* data();
+
+  // moveTo makes the content (starting at offset) the payload of the given
+  // response and clears this buffer.
+  void moveTo(Response& response, std::size_t offset);
+
+  // clear removes the content, the configuration is kept.
+  void clear();
+  // swap exchanges the content of both buffers, the configurations are kept.
+  void swap(SpillBuffer& other);
+
+ private:
+  void spill();
+  void flush();
+
+ private:
+  std::size_t _threshold;
+  std::string _directory;
+  VBuffer _buffer;                   // content or data not yet written to the file
+  int _fd;                           // temporary file (-1 = none)
+  std::size_t _size;                 // size of the entire content
+  std::shared_ptr<MappedFile> _file; // mapped temporary file
+};
+
+}}}
+#endif
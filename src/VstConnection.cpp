@@ -78,6 +78,7 @@ std::shared_ptr<RequestItem> VstConnection::createRequestItem(std::unique_ptr<Re
   item->_messageID = request->messageID;
   item->_callback = cb;
   item->_request = std::move(request);
+  item->_responseChunkContent.configure(_configuration);
   item->prepareForNetwork(_vstVersion);
 
   return item;
@@ -93,6 +94,8 @@ std::size_t VstConnection::requestsLeft() {
 VstConnection::VstConnection(EventLoopService& eventLoopService, ConnectionConfiguration const& configuration)
     : Connection(eventLoopService, configuration)
     , _vstVersion(configuration._vstVersion)
+    , _readChunks(vst::readChunksFunction(configuration._vstVersion))
+    , _receivedMessages(0)
     , _messageID(0)
     , _ioService(eventLoopService.io_service())
     , _resolver(new bt::resolver(*eventLoopService.io_service()))
@@ -254,10 +257,10 @@ void VstConnection::finishInitialization(){
   const char* vstHeader;
   switch (_vstVersion) {
     case VST1_0:
-      vstHeader = vstHeader1_0;
+      vstHeader = vst::ChunkCodec<VST1_0>::protocolHeader();
       break;
     case VST1_1:
-      vstHeader = vstHeader1_1;
+      vstHeader = vst::ChunkCodec<VST1_1>::protocolHeader();
       break;
     default:
       throw std::logic_error("Unknown VST version");
@@ -470,29 +473,30 @@ void VstConnection::ReadLoop::asyncReadCallback(const boost::system::error_code&
     auto receivedBuf = _receiveBuffer.data(); // no copy
     auto cursor = boost::asio::buffer_cast<const uint8_t*>(receivedBuf);
     auto available = boost::asio::buffer_size(receivedBuf);
-    while (vst::isChunkComplete(cursor, available)) {
-      // Read chunk 
-      ChunkHeader chunk;
-      switch (_connection->_vstVersion) {
-        case VST1_0:
-          chunk = vst::readChunkHeaderVST1_0(cursor);
-          break;
-        case VST1_1:
-          chunk = vst::readChunkHeaderVST1_1(cursor);
-          break;
-        default:
-          throw std::logic_error("Unknown VST version");
-      }
 
-      // Process chunk 
-      _connection->processChunk(chunk);
+    // Read all complete chunks at once
+    _chunks.clear();
+    std::size_t consumed;
+    try {
+      consumed = _connection->_readChunks(cursor, available, _chunks);
+    } catch (std::exception const& e) {
+      // the stream cannot be resynchronized
+      FUERTE_LOG_ERROR << "invalid VST chunk: " << e.what() << std::endl;
+      _connection->restartConnection(this, ErrorCondition::VstProtocolError);
+      return;
+    }
 
-      // Remove consumed data from receive buffer.
-      _receiveBuffer.consume(chunk.chunkLength());
-      cursor += chunk.chunkLength();
-      available -= chunk.chunkLength();
+    // Process chunks
+    for (auto& chunk : _chunks) {
+      if (!_connection->processChunk(chunk)) {
+        _connection->restartConnection(this, ErrorCondition::VstProtocolError);
+        return;
+      }
     }
 
+    // Remove consumed data from receive buffer.
+    _receiveBuffer.consume(consumed);
+
     // Continue reading data
     readNextBytes();
   }
@@ -508,7 +512,9 @@ void VstConnection::ReadLoop::deadlineHandler(const boost::system::error_code& e
 }
 
 // Process the given incoming chunk.
-void VstConnection::processChunk(ChunkHeader &chunk) {
+// Returns false when the response is invalid, the request has failed then
+// and the connection must be restarted.
+bool VstConnection::processChunk(ChunkHeader &chunk) {
   auto msgID = chunk.messageID();
   FUERTE_LOG_VSTTRACE << "processChunk: messageID=" << msgID << std::endl;
 
@@ -516,14 +522,47 @@ void VstConnection::processChunk(ChunkHeader &chunk) {
   auto item = _messageStore.findByID(chunk._messageID);
   if (!item) {
     FUERTE_LOG_ERROR << "got chunk with unknown message ID: " << msgID << std::endl;
-    return;
+    return true;
   }
 
   // We've found the matching RequestItem.
-  item->addChunk(chunk);
+  if (item->_request->responseDataCallback()) {
+    // Streamed response, the payload is passed on as it arrives
+    std::unique_ptr<Response> response;
+    try {
+      if (!item->streamChunk(chunk)) {
+        return true;
+      }
+      FUERTE_LOG_VSTTRACE << "processChunk: streamed response complete" << std::endl;
+      _messageStore.removeByID(item->_messageID);
+
+      // The response carries the message header only
+      SpillBuffer headerBuffer;
+      headerBuffer.append(item->_streamHeader.data(), item->_streamHeader.byteSize());
+      response = createResponse(*item, headerBuffer);
+    } catch (std::exception const& e) {
+      FUERTE_LOG_ERROR << "invalid VST response: " << e.what() << std::endl;
+      _messageStore.removeByID(item->_messageID);
+      item->invokeOnError(errorToInt(ErrorCondition::VstProtocolError), std::move(item->_request), nullptr);
+      return false;
+    }
+    item->_callback.invoke(0, std::move(item->_request), std::move(response));
+    return true;
+  }
+
+  std::unique_ptr<SpillBuffer> completeBuffer;
+  try {
+    item->addChunk(chunk);
 
-  // Try to assembly chunks in RequestItem to complete response.
-  auto completeBuffer = item->assemble();
+    // Try to assembly chunks in RequestItem to complete response.
+    completeBuffer = item->assemble();
+  } catch (std::exception const& e) {
+    // the temporary file of a large response could not be written
+    FUERTE_LOG_ERROR << "cannot store response: " << e.what() << std::endl;
+    _messageStore.removeByID(item->_messageID);
+    item->invokeOnError(errorToInt(ErrorCondition::VstReadError), std::move(item->_request), nullptr);
+    return true;
+  }
   if (completeBuffer) {
     FUERTE_LOG_VSTTRACE << "processChunk: complete response received" << std::endl;
     // Message is complete 
@@ -531,30 +570,70 @@ void VstConnection::processChunk(ChunkHeader &chunk) {
     _messageStore.removeByID(item->_messageID);
 
     // Create response
-    auto response = createResponse(*item, completeBuffer);
+    std::unique_ptr<Response> response;
+    try {
+      response = createResponse(*item, *completeBuffer);
+    } catch (std::exception const& e) {
+      FUERTE_LOG_ERROR << "invalid VST response: " << e.what() << std::endl;
+      item->invokeOnError(errorToInt(ErrorCondition::VstProtocolError), std::move(item->_request), nullptr);
+      return false;
+    }
 
     // Notify listeners
     FUERTE_LOG_VSTTRACE << "processChunk: notifying RequestItem onSuccess callback" << std::endl;
     item->_callback.invoke(0, std::move(item->_request), std::move(response));
   }
+  return true;
 }
 
 // Create a response object for given RequestItem & received response buffer.
-std::unique_ptr<Response> VstConnection::createResponse(RequestItem& item, std::unique_ptr<VBuffer>& responseBuffer) {
+std::unique_ptr<Response> VstConnection::createResponse(RequestItem& item, SpillBuffer& responseBuffer) {
   FUERTE_LOG_VSTTRACE << "creating response for item with messageid: " << item._messageID << std::endl;
-  auto itemCursor = responseBuffer->data();
-  auto itemLength = responseBuffer->byteSize();
-  std::size_t messageHeaderLength;
+  auto itemCursor = responseBuffer.data();
+  auto itemLength = responseBuffer.size();
   int vstVersionID = 1;
-  MessageHeader messageHeader = validateAndExtractMessageHeader(vstVersionID, itemCursor, itemLength, messageHeaderLength);
+  std::size_t messageHeaderLength = validateMessage(itemCursor, itemLength);
 
-  auto response = std::unique_ptr<Response>(new Response(std::move(messageHeader)));
+  auto response = std::unique_ptr<Response>(new Response());
   response->messageID = item._messageID;
-  response->setPayload(std::move(*responseBuffer), messageHeaderLength);
+  responseBuffer.moveTo(*response, messageHeaderLength);
+
+  // The header stays in the payload buffer of the response, in front of the
+  // payload. Only its fixed fields are read now, the meta data is decoded
+  // when it is accessed.
+  auto headerStart = boost::asio::buffer_cast<uint8_t const*>(response->payload()) - messageHeaderLength;
+  VSlice headerSlice(headerStart);
+  response->header = messageHeaderFromSlice(vstVersionID, headerSlice, false);
+  if (headerSlice.length() >= 4) {
+    response->header.meta.assignLazy(headerSlice.at(3));
+  }
 
   return response;
 }
 
+// Validate the given message as configured and return the size of its header.
+std::size_t VstConnection::validateMessage(uint8_t const* data, std::size_t length) {
+  auto level = _configuration._vstValidation;
+  if (level == vst::ValidateSampled) {
+    auto rate = std::max(_configuration._vstValidationSampleRate, std::size_t(1));
+    level = (_receivedMessages++ % rate == 0) ? vst::ValidateFull : vst::ValidateHeader;
+  }
+
+  switch (level) {
+    case vst::ValidateNone:
+      return messageHeaderSize(data, length);
+    case vst::ValidateFull: {
+      std::size_t headerLength = checkResponseHeader(data, length);
+      if (length > headerLength) {
+        validateAndCount(data + headerLength, length - headerLength);
+      }
+      return headerLength;
+    }
+    default:
+      return checkResponseHeader(data, length);
+  }
+}
+
 // ------------------------------------
 // Writing data
 // ------------------------------------
@@ -664,9 +743,16 @@ void VstConnection::WriteLoop::sendNextRequest() {
   FUERTE_LOG_VSTTRACE << "sendNextRequest: preparing to send next" << std::endl;
 
   // make sure we are connected and handshake has been done
-  auto self = shared_from_this();
   assert(next);
   assert(next->_requestBuffers.size());
+  writeRequestBuffers(std::move(next));
+
+  FUERTE_LOG_VSTTRACE << "sendNextRequest: done" << std::endl;
+}
+
+// writes the request buffers of the given item using boost::asio::async_write
+void VstConnection::WriteLoop::writeRequestBuffers(std::shared_ptr<RequestItem> next) {
+  auto self = shared_from_this();
 
   // Set timeout 
   auto reqTimeout = std::chrono::duration_cast<std::chrono::milliseconds>(next->_request->timeout());
@@ -685,8 +771,6 @@ void VstConnection::WriteLoop::sendNextRequest() {
     [this, self, next](BoostEC const& error, std::size_t transferred) {
       asyncWriteCallback(error, transferred, next);
     });
-
-  FUERTE_LOG_VSTTRACE << "sendNextRequest: done" << std::endl;
 }
 
 // callback of async_write function that is called in sendNextRequest.
@@ -716,6 +800,23 @@ void VstConnection::WriteLoop::asyncWriteCallback(BoostEC const& error, std::siz
     // request is written we no longer data for that
     item->resetSendData();
 
+    // Write the rest of a streamed body first
+    bool bodyPending;
+    try {
+      bodyPending = item->nextBodyChunks(_connection->_vstVersion);
+    } catch (std::exception const& e) {
+      FUERTE_LOG_ERROR << "cannot read request body: " << e.what() << std::endl;
+      _connection->_messageStore.removeByID(item->_messageID);
+      item->_callback.invoke(errorToInt(ErrorCondition::VstWriteError), std::move(item->_request), nullptr);
+      // part of the message is on the wire already
+      _connection->restartConnection(this, ErrorCondition::VstWriteError);
+      return;
+    }
+    if (bodyPending) {
+      writeRequestBuffers(std::move(item));
+      return;
+    }
+
     // Continue with next request (if any)
     FUERTE_LOG_CALLBACKS << "asyncWriteCallback: send next request (if any)" << std::endl;
     sendNextRequest();
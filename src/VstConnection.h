@@ -131,9 +131,12 @@ private:
   void restartConnection(const ReadLoop*, const ErrorCondition);
 
   // Process the given incoming chunk.
-  void processChunk(ChunkHeader &chunk);
+  // Returns false when the response is invalid, the connection must be restarted then.
+  bool processChunk(ChunkHeader &chunk);
   // Create a response object for given RequestItem & received response buffer.
-  std::unique_ptr<Response> createResponse(RequestItem& item, std::unique_ptr<VBuffer>& responseBuffer);
+  std::unique_ptr<Response> createResponse(RequestItem& item, SpillBuffer& responseBuffer);
+  // validate the given message as configured and return the size of its header
+  std::size_t validateMessage(uint8_t const* data, std::size_t length);
 
   class WriteLoop;
 
@@ -149,6 +152,10 @@ private:
 
 private:
   const VSTVersion _vstVersion;
+  // reads chunks in the format of _vstVersion
+  const vst::ReadChunksFunction _readChunks;
+  // number of received messages, used to sample messages for validation
+  std::atomic_uint_least64_t _receivedMessages;
   // TODO FIXME -- fix alignment when done so mutexes are not on the same cacheline etc
   std::atomic_uint_least64_t _messageID;
   // host resolving 
@@ -260,6 +267,7 @@ private:
     std::shared_ptr<VstConnection> _connection;
     std::shared_ptr<::boost::asio::ip::tcp::socket> _socket;
     ::boost::asio::streambuf _receiveBuffer; // async read can not run concurrent
+    std::vector<ChunkHeader> _chunks;        // chunks read from _receiveBuffer
     std::atomic_bool _started;
     ::boost::asio::deadline_timer _deadline;
   };
@@ -279,6 +287,8 @@ private:
    private:
     // writes data from task queue to network using boost::asio::async_write
     void sendNextRequest();
+    // writes the request buffers of the given item using boost::asio::async_write
+    void writeRequestBuffers(std::shared_ptr<RequestItem>);
     // handler for boost::asio::async_wirte that calls startWrite as long as there is new data
     void asyncWriteCallback(boost::system::error_code const&, std::size_t transferred, std::shared_ptr<RequestItem>);
     // handler for deadline timer
@@ -0,0 +1,222 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include <fuerte/batch.h>
+#include <fuerte/connection.h>
+#include <fuerte/helper.h>
+#include <fuerte/requests.h>
+#include <velocypack/Parser.h>
+
+#include "http.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 {
+
+namespace {
+using Parts = std::vector<std::pair<std::unique_ptr<Request>, RequestCallback>>;
+
+// find returns the position of the given string in [begin, end), or end.
+char const* find(char const* begin, char const* end, std::string const& what) {
+  return std::search(begin, end, what.begin(), what.end());
+}
+
+// startsWithLower returns true when the line starts with the given lower
+// case prefix, ignoring the case of the line.
+bool startsWithLower(char const* begin, char const* end, char const* prefix) {
+  for (; *prefix != '\0'; prefix++, begin++) {
+    if (begin == end || std::tolower(static_cast<unsigned char>(*begin)) != *prefix) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// parsePart parses the HTTP response in the given part body.
+std::unique_ptr<Response> parsePart(char const* begin, char const* end) {
+  http::ResponseParser parser;
+  parser.feed(reinterpret_cast<uint8_t const*>(begin), end - begin);
+  if (!parser.done() && !parser.finish()) {
+    throw std::runtime_error("incomplete batch part");
+  }
+  auto response = parser.takeResponse();
+  if (response->isContentTypeJSON()) {
+    auto payload = response->payload();
+    auto parsed = ::arangodb::velocypack::Parser::fromJson(
+        boost::asio::buffer_cast<uint8_t const*>(payload), boost::asio::buffer_size(payload));
+    VBuffer buffer;
+    buffer.append(parsed->slice().start(), parsed->slice().byteSize());
+    response->setPayload(std::move(buffer), 0);
+    response->header.contentType(ContentType::VPack);
+  }
+  return response;
+}
+
+// deliver splits the multipart body of a batch response and passes the
+// response of each part to the callback of its request.
+void deliver(Parts& parts, Response& response, std::string const& boundary) {
+  // the server may answer with a boundary of its own
+  std::string delimiter = "--" + boundary;
+  auto contentType = response.header.metaByKey(fu_content_type_key);
+  auto pos = contentType.find("boundary=");
+  if (pos != std::string::npos) {
+    auto value = contentType.substr(pos + 9);
+    value = value.substr(0, value.find(';'));
+    value.erase(std::remove(value.begin(), value.end(), '"'), value.end());
+    delimiter = "--" + value;
+  }
+
+  std::vector<std::unique_ptr<Response>> results(parts.size());
+  auto payload = response.payload();
+  auto cursor = boost::asio::buffer_cast<char const*>(payload);
+  auto end = cursor + boost::asio::buffer_size(payload);
+  cursor = find(cursor, end, delimiter);
+  std::size_t index = 0;
+  while (cursor != end) {
+    cursor += delimiter.size();
+    if (end - cursor >= 2 && cursor[0] == '-' && cursor[1] == '-') {
+      break; // closing delimiter
+    }
+    auto next = find(cursor, end, delimiter);
+
+    // part headers up to an empty line, the part body is an HTTP response
+    std::size_t id = index++;
+    auto line = find(cursor, next, "\r\n");
+    if (line != next) {
+      line += 2;
+    }
+    while (line < next) {
+      auto lineEnd = find(line, next, "\r\n");
+      if (lineEnd == line) {
+        line += 2;
+        break;
+      }
+      if (startsWithLower(line, lineEnd, "content-id:")) {
+        id = std::strtoull(std::string(line + 11, lineEnd).c_str(), nullptr, 10);
+      }
+      line = lineEnd == next ? next : lineEnd + 2;
+    }
+    auto bodyEnd = next;
+    if (bodyEnd - line >= 2 && bodyEnd[-2] == '\r' && bodyEnd[-1] == '\n') {
+      bodyEnd -= 2;
+    }
+    if (id < results.size() && line < bodyEnd) {
+      try {
+        results[id] = parsePart(line, bodyEnd);
+      } catch (std::exception const&) {
+        // the callback of the part gets a protocol error
+      }
+    }
+    cursor = next;
+  }
+
+  for (std::size_t i = 0; i < parts.size(); i++) {
+    auto& part = parts[i];
+    if (results[i]) {
+      part.second(0, std::move(part.first), std::move(results[i]));
+    } else {
+      part.second(errorToInt(ErrorCondition::HttpProtocolError), std::move(part.first), nullptr);
+    }
+  }
+}
+}
+
+Batch::Batch(std::shared_ptr<Connection> conn, std::string const& database)
+  : _conn(conn)
+  , _database(database)
+  {
+    std::random_device random;
+    std::ostringstream boundary;
+    boundary << "fuerte-batch-" << std::hex << random() << random();
+    _boundary = boundary.str();
+  }
+
+void Batch::add(std::unique_ptr<Request> request, RequestCallback cb) {
+  if (request->bodySource()) {
+    throw std::invalid_argument("requests with a body source cannot be batched");
+  }
+  std::lock_guard<std::mutex> lock(_mutex);
+  _parts.emplace_back(std::move(request), std::move(cb));
+}
+
+std::size_t Batch::size() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _parts.size();
+}
+
+void Batch::send() {
+  auto parts = std::make_shared<Parts>();
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::swap(*parts, _parts);
+  }
+  if (parts->empty()) {
+    return;
+  }
+
+  std::string body;
+  for (std::size_t i = 0; i < parts->size(); i++) {
+    auto& request = *(*parts)[i].first;
+    body.append("--").append(_boundary).append("\r\n");
+    body.append("Content-Type: application/x-arango-batchpart\r\n");
+    body.append("Content-Id: ").append(std::to_string(i)).append("\r\n\r\n");
+    // parts run in the database of the batch
+    auto database = std::move(request.header.database);
+    request.header.database = boost::none;
+    http::appendRequestHead(body, request, "localhost", std::string());
+    request.header.database = std::move(database);
+    auto payload = request.payload();
+    body.append(boost::asio::buffer_cast<char const*>(payload), boost::asio::buffer_size(payload));
+    body.append("\r\n");
+  }
+  body.append("--").append(_boundary).append("--\r\n");
+
+  auto request = createRequest(RestVerb::Post, "/_api/batch");
+  request->header.database = _database;
+  request->addBinary(reinterpret_cast<uint8_t const*>(body.data()), body.size());
+  request->contentType("multipart/form-data; boundary=" + _boundary);
+
+  auto boundary = _boundary;
+  _conn->sendRequest(std::move(request), [parts, boundary](Error error, std::unique_ptr<Request>, std::unique_ptr<Response> response) {
+    if (error != 0 || !response) {
+      for (auto& part : *parts) {
+        part.second(error != 0 ? error : errorToInt(ErrorCondition::ConnectionError), std::move(part.first), nullptr);
+      }
+      return;
+    }
+    if (response->statusCode() != StatusOK) {
+      // the batch was rejected as a whole
+      for (auto& part : *parts) {
+        part.second(0, std::move(part.first), copyResponse(*response));
+      }
+      return;
+    }
+    deliver(*parts, *response, boundary);
+  });
+}
+
+}}}
@@ -20,15 +20,251 @@
 /// @author Jan Christoph Uhde
 ////////////////////////////////////////////////////////////////////////////////
 #include <fuerte/collection.h>
+#include <fuerte/connection.h>
 #include <fuerte/database.h>
+#include <fuerte/importer.h>
+#include <fuerte/requests.h>
+
+#include "DocumentBatcher.h"
+#include "DocumentCache.h"
+#include "QueryCache.h"
 
 namespace arangodb { namespace fuerte { inline namespace v1 {
 
   using namespace arangodb::fuerte::detail;
 
+  namespace {
+  // sendDocumentRequest sends a request that is not batched and passes the
+  // returned object to the callback.
+  void sendDocumentRequest(Database& db, std::unique_ptr<Request> request, DocumentCallback cb){
+    request->header.database = db.name();
+    db.connection()->sendRequest(std::move(request), [cb](Error error, std::unique_ptr<Request>, std::unique_ptr<Response> response){
+      if (error != 0 || !response) {
+        cb(error != 0 ? error : errorToInt(ErrorCondition::ConnectionError), VSlice());
+        return;
+      }
+      VSlice result;
+      try {
+        auto const& slices = response->slices();
+        if (!slices.empty()) {
+          result = slices.front();
+        }
+      } catch (std::exception const&) {
+        cb(errorToInt(ErrorCondition::ErrorCastError), VSlice());
+        return;
+      }
+      cb(0, result);
+    });
+  }
+
+  // documentKey returns the key of a document given as key string or as
+  // object with _key, or an empty string.
+  std::string documentKey(VSlice const& document){
+    VSlice key = document.isObject() ? document.get("_key") : document;
+    return key.isString() ? key.copyString() : std::string();
+  }
+
+  // cacheRead returns a callback that stores the document it receives.
+  DocumentCallback cacheRead(std::shared_ptr<impl::DocumentCache> const& cache, DocumentCallback cb){
+    auto epoch = cache->epoch();
+    return [cache, epoch, cb](Error error, VSlice result){
+      if (error == 0) {
+        cache->store(result, epoch);
+      }
+      cb(error, result);
+    };
+  }
+
+  // cacheWrite returns a callback that stores the written document with the
+  // revision the server returned.
+  DocumentCallback cacheWrite(std::shared_ptr<impl::DocumentCache> const& cache, VSlice const& document, DocumentCallback cb){
+    auto copy = std::make_shared<VBuilder>();
+    copy->add(document);
+    return [cache, copy, cb](Error error, VSlice result){
+      if (error == 0) {
+        cache->store(copy->slice(), result);
+      }
+      cb(error, result);
+    };
+  }
+
+  // invalidateQueries drops the cached query results that read the given
+  // collection now, and once more when the write finished.
+  DocumentCallback invalidateQueries(std::shared_ptr<impl::QueryCache> const& cache, std::string const& collection, DocumentCallback cb){
+    cache->invalidate(collection);
+    return [cache, collection, cb](Error error, VSlice result){
+      cache->invalidate(collection);
+      cb(error, result);
+    };
+  }
+
+  // cacheErase returns a callback that removes the document with the given
+  // key once more, reads sent before the write finished may have stored it.
+  DocumentCallback cacheErase(std::shared_ptr<impl::DocumentCache> const& cache, std::string const& key, DocumentCallback cb){
+    return [cache, key, cb](Error error, VSlice result){
+      cache->erase(key);
+      cb(error, result);
+    };
+  }
+  }
+
   Collection::Collection(std::shared_ptr<Database> db, std::string name)
     : _db(db)
     , _name(name)
-    {}
+    {
+      batching(BatchOptions());
+    }
+
+  // Pending documents are sent by the batchers.
+  Collection::~Collection() {}
+
+  void Collection::batching(BatchOptions const& options){
+    flush();
+    _batchOptions = options;
+    auto path = "/_api/document/" + _name;
+    auto const& conn = _db->connection();
+    _inserts = std::make_shared<impl::DocumentBatcher>(conn, _db->name(), RestVerb::Post, path, options);
+    _updates = std::make_shared<impl::DocumentBatcher>(conn, _db->name(), RestVerb::Patch, path, options);
+    _replaces = std::make_shared<impl::DocumentBatcher>(conn, _db->name(), RestVerb::Put, path, options);
+    _drops = std::make_shared<impl::DocumentBatcher>(conn, _db->name(), RestVerb::Delete, path, options);
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    _lastWrite.reset();
+  }
+
+  void Collection::lookups(BatchOptions const& options){
+    if (_lookups) {
+      _lookups->flush();
+    }
+    StringMap parameters;
+    parameters.emplace("onlyget", "true");
+    _lookups = std::make_shared<impl::DocumentBatcher>(_db->connection(), _db->name(), RestVerb::Put,
+                                                       "/_api/document/" + _name, options, parameters);
+  }
+
+  void Collection::caching(CacheOptions const& options){
+    if (options.maxBytes == 0) {
+      _cache.reset();
+      return;
+    }
+    _cache = std::make_shared<impl::DocumentCache>(options);
+  }
+
+  void Collection::flush(){
+    for (auto const& batcher : {_inserts, _updates, _replaces, _drops, _lookups}) {
+      if (batcher) {
+        batcher->flush();
+      }
+    }
+  }
+
+  impl::DocumentBatcher& Collection::ordered(std::shared_ptr<impl::DocumentBatcher> const& batcher){
+    std::shared_ptr<impl::DocumentBatcher> previous;
+    {
+      std::lock_guard<std::mutex> lock(_writeMutex);
+      if (_lastWrite != batcher) {
+        previous = std::move(_lastWrite);
+        _lastWrite = batcher;
+      }
+    }
+    if (previous) {
+      previous->flush();
+    }
+    return *batcher;
+  }
+
+  void Collection::insert(VSlice const& document, DocumentCallback cb){
+    if (_db->_queryCache) {
+      cb = invalidateQueries(_db->_queryCache, _name, std::move(cb));
+    }
+    if (_cache) {
+      cb = cacheWrite(_cache, document, std::move(cb));
+    }
+    ordered(_inserts).add(document, std::move(cb));
+  }
+
+  void Collection::update(VSlice const& document, DocumentCallback cb){
+    if (_db->_queryCache) {
+      cb = invalidateQueries(_db->_queryCache, _name, std::move(cb));
+    }
+    if (_cache) {
+      // the result carries no document, the next find fetches it
+      auto key = documentKey(document);
+      _cache->erase(key);
+      cb = cacheErase(_cache, key, std::move(cb));
+    }
+    if (_batchOptions.combineUpdates) {
+      ordered(_updates).merge(document, std::move(cb));
+      return;
+    }
+    ordered(_updates).add(document, std::move(cb));
+  }
+
+  void Collection::replace(VSlice const& document, DocumentCallback cb){
+    if (_db->_queryCache) {
+      cb = invalidateQueries(_db->_queryCache, _name, std::move(cb));
+    }
+    if (_cache) {
+      _cache->erase(documentKey(document));
+      cb = cacheWrite(_cache, document, std::move(cb));
+    }
+    ordered(_replaces).add(document, std::move(cb));
+  }
+
+  void Collection::drop(VSlice const& document, DocumentCallback cb){
+    if (_db->_queryCache) {
+      cb = invalidateQueries(_db->_queryCache, _name, std::move(cb));
+    }
+    if (_cache) {
+      auto key = documentKey(document);
+      _cache->erase(key);
+      cb = cacheErase(_cache, key, std::move(cb));
+    }
+    ordered(_drops).add(document, std::move(cb));
+  }
+
+  void Collection::dropAll(DocumentCallback cb){
+    flush();
+    if (_db->_queryCache) {
+      cb = invalidateQueries(_db->_queryCache, _name, std::move(cb));
+    }
+    if (_cache) {
+      _cache->clear();
+      auto cache = _cache;
+      auto next = std::move(cb);
+      cb = [cache, next](Error error, VSlice result){
+        cache->clear();
+        next(error, result);
+      };
+    }
+    sendDocumentRequest(*_db, createRequest(RestVerb::Put, "/_api/collection/" + _name + "/truncate"), std::move(cb));
+  }
+
+  void Collection::find(std::string const& key, DocumentCallback cb){
+    if (_cache) {
+      auto cached = _cache->find(key);
+      if (cached) {
+        cb(0, VSlice(cached->data()));
+        return;
+      }
+      cb = cacheRead(_cache, std::move(cb));
+    }
+    if (_lookups) {
+      _lookups->addKey(key, std::move(cb));
+      return;
+    }
+    sendDocumentRequest(*_db, createRequest(RestVerb::Get, "/_api/document/" + _name + "/" + key), std::move(cb));
+  }
+
+  std::shared_ptr<Importer> Collection::importer(ImportOptions const& options){
+    ImportOptions importOptions = options;
+    if (importOptions.connections.empty()) {
+      importOptions.connections.push_back(_db->connection());
+    }
+    return std::shared_ptr<Importer>( new Importer(_db->name(), _name, importOptions) );
+  }
+
+  std::shared_ptr<Importer> Collection::importer(){
+    return importer(ImportOptions());
+  }
 
 }}}
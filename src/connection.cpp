@@ -22,6 +22,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <fuerte/connection.h>
+#include <fuerte/database.h>
 #include <fuerte/FuerteLogger.h>
 #include <fuerte/waitgroup.h>
 
@@ -64,4 +65,8 @@ std::unique_ptr<Response> Connection::sendRequest(std::unique_ptr<Request> reque
   return std::move(rv);
 }
 
+std::shared_ptr<Database> Connection::getDatabase(std::string const& name){
+  return std::shared_ptr<Database>( new Database(shared_from_this(), name) );
+}
+
 }}}
@@ -0,0 +1,194 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdexcept>
+
+#include <fuerte/connection.h>
+#include <fuerte/cursor.h>
+#include <fuerte/FuerteLogger.h>
+#include <fuerte/requests.h>
+
+namespace arangodb { namespace fuerte { inline namespace v1 {
+
+namespace {
+// deleteCursor deletes the cursor with the given id on the server.
+void deleteCursor(std::shared_ptr<Connection> const& conn, std::string const& database, std::string const& id) {
+  auto request = createRequest(RestVerb::Delete, "/_api/cursor/" + id);
+  request->header.database = database;
+  try {
+    conn->sendRequest(std::move(request), [](Error, std::unique_ptr<Request>, std::unique_ptr<Response>) {});
+  } catch (std::exception const& e) {
+    // the server deletes the cursor after its ttl
+    FUERTE_LOG_ERROR << "cannot delete cursor " << id << ": " << e.what() << std::endl;
+  }
+}
+}
+
+Cursor::Cursor(std::shared_ptr<Connection> conn, std::string const& database,
+               std::size_t prefetch)
+  : _conn(conn)
+  , _database(database)
+  , _prefetch(prefetch)
+  , _fetching(true)
+  , _hasMore(true)
+  , _error(0)
+  {}
+
+Cursor::~Cursor() {
+  // the cursor only exists on the server while it has more batches.
+  // A batch request in flight must not overlap with the delete, its
+  // callback deletes the cursor instead (see send).
+  if (!_fetching && _hasMore && !_id.empty()) {
+    deleteCursor(_conn, _database, _id);
+  }
+}
+
+std::unique_ptr<Response> Cursor::next() {
+  std::unique_ptr<Request> request;
+  std::unique_ptr<Response> batch;
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_batches.empty()) {
+      // nothing fetched ahead, ask for the next batch now
+      request = nextRequest(true);
+    }
+    if (request) {
+      lock.unlock();
+      send(std::move(request));
+      lock.lock();
+    }
+    _condition.wait(lock, [this] {
+      return !_batches.empty() || _error != 0 || !_errorMessage.empty() || !_fetching;
+    });
+    if (_batches.empty()) {
+      if (_error != 0) {
+        throw intToError(_error);
+      }
+      if (!_errorMessage.empty()) {
+        throw std::runtime_error("cursor error: " + _errorMessage);
+      }
+      return nullptr;
+    }
+    batch = std::move(_batches.front());
+    _batches.pop_front();
+    // there is room for another batch now
+    request = nextRequest(false);
+  }
+  if (request) {
+    send(std::move(request));
+  }
+  return batch;
+}
+
+std::size_t Cursor::available() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _batches.size();
+}
+
+std::string Cursor::id() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _id;
+}
+
+void Cursor::start(std::unique_ptr<Request> request) {
+  request->header.database = _database;
+  send(std::move(request));
+}
+
+std::unique_ptr<Request> Cursor::nextRequest(bool force) {
+  if (_fetching || !_hasMore || _error != 0 || !_errorMessage.empty()) {
+    return nullptr;
+  }
+  if (!force && _batches.size() >= _prefetch) {
+    return nullptr;
+  }
+  _fetching = true;
+  auto request = createRequest(RestVerb::Put, "/_api/cursor/" + _id);
+  request->header.database = _database;
+  return request;
+}
+
+void Cursor::send(std::unique_ptr<Request> request) {
+  // the callback must not keep the cursor alive, so it can be deleted early
+  std::weak_ptr<Cursor> weak = shared_from_this();
+  auto conn = _conn;
+  auto database = _database;
+  _conn->sendRequest(std::move(request), [weak, conn, database](Error error, std::unique_ptr<Request>, std::unique_ptr<Response> response) {
+    auto self = weak.lock();
+    if (self) {
+      self->received(error, std::move(response));
+      return;
+    }
+    // the cursor was dropped while this batch was fetched
+    if (error != 0 || !response || response->statusCode() >= 400) {
+      return;
+    }
+    try {
+      auto slice = response->slices().front();
+      auto hasMore = slice.get("hasMore");
+      auto id = slice.get("id");
+      if (hasMore.isBool() && hasMore.getBool() && id.isString()) {
+        deleteCursor(conn, database, id.copyString());
+      }
+    } catch (std::exception const&) {
+      // nothing to delete
+    }
+  });
+}
+
+void Cursor::received(Error error, std::unique_ptr<Response> response) {
+  std::unique_ptr<Request> request;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _fetching = false;
+    if (error != 0 || !response) {
+      _error = error != 0 ? error : errorToInt(ErrorCondition::ConnectionError);
+    } else {
+      try {
+        auto slice = response->slices().front();
+        if (response->statusCode() >= 400) {
+          auto message = slice.get("errorMessage");
+          _errorMessage = message.isString() ? message.copyString()
+                                             : "invalid status " + std::to_string(response->statusCode());
+        } else {
+          auto hasMore = slice.get("hasMore");
+          _hasMore = hasMore.isBool() && hasMore.getBool();
+          auto id = slice.get("id");
+          if (id.isString()) {
+            _id = id.copyString();
+          }
+          _batches.push_back(std::move(response));
+          // fetch ahead while the consumer works on this batch
+          request = nextRequest(false);
+        }
+      } catch (std::exception const& e) {
+        _errorMessage = e.what();
+      }
+    }
+  }
+  _condition.notify_all();
+  if (request) {
+    send(std::move(request));
+  }
+}
+
+}}}
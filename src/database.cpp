@@ -21,9 +21,16 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <fuerte/database.h>
+#include <fuerte/batch.h>
 #include <fuerte/collection.h> //required by new
 #include <fuerte/connection.h> //required by _conn
+#include <fuerte/cursor.h> //required by new
 #include <fuerte/message.h> //required by _conn
+#include <fuerte/requests.h>
+#include <fuerte/transaction.h>
+#include <velocypack/Iterator.h>
+
+#include "QueryCache.h"
 
 namespace arangodb { namespace fuerte { inline namespace v1 {
 
@@ -45,4 +52,83 @@ namespace arangodb { namespace fuerte { inline namespace v1 {
     return false;
   }
 
+  std::shared_ptr<Cursor> Database::createCursor(std::string const& query,
+                                                 VSlice const& bindVars,
+                                                 std::size_t batchSize,
+                                                 std::size_t prefetch){
+    VBuilder builder;
+    builder.openObject();
+    builder.add("query", VValue(query));
+    if (bindVars.isObject()) {
+      builder.add("bindVars", bindVars);
+    }
+    if (batchSize > 0) {
+      builder.add("batchSize", VValue(static_cast<uint64_t>(batchSize)));
+    }
+    builder.close();
+
+    auto cursor = std::shared_ptr<Cursor>( new Cursor(_conn, _name, prefetch) );
+    cursor->start(createRequest(RestVerb::Post, "/_api/cursor", StringMap(), builder.slice()));
+    return cursor;
+  }
+
+  std::shared_ptr<Batch> Database::createBatch(){
+    return std::shared_ptr<Batch>( new Batch(_conn, _name) );
+  }
+
+  std::shared_ptr<Transaction> Database::beginTransaction(TransactionOptions const& options){
+    auto transaction = std::shared_ptr<Transaction>( new Transaction(_conn, _name, options.maxDocuments) );
+    transaction->begin(options);
+    return transaction;
+  }
+
+  void Database::queryCaching(QueryCacheOptions const& options){
+    if (options.maxBytes == 0) {
+      _queryCache.reset();
+      return;
+    }
+    _queryCache = std::make_shared<impl::QueryCache>(options);
+  }
+
+  std::shared_ptr<VBuffer const> Database::query(std::string const& query,
+                                                 VSlice const& bindVars,
+                                                 std::vector<std::string> const& collections){
+    auto cache = _queryCache;
+    std::string key;
+    uint64_t epoch = 0;
+    if (cache) {
+      key = impl::QueryCache::key(query, bindVars);
+      auto cached = cache->find(key);
+      if (cached) {
+        return cached;
+      }
+      epoch = cache->epoch();
+    }
+
+    auto cursor = createCursor(query, bindVars);
+    VBuilder builder;
+    builder.openArray();
+    while (auto batch = cursor->next()) {
+      for (auto const& document : ::arangodb::velocypack::ArrayIterator(batch->slices().front().get("result"))) {
+        builder.add(document);
+      }
+    }
+    builder.close();
+
+    auto slice = builder.slice();
+    std::shared_ptr<VBuffer> result(new VBuffer(slice.byteSize()));
+    result->append(slice.start(), slice.byteSize());
+    if (cache) {
+      cache->store(key, result, collections, epoch);
+    }
+    return result;
+  }
+
+  void Database::invalidateQueries(std::string const& collection){
+    auto cache = _queryCache;
+    if (cache) {
+      cache->invalidate(collection);
+    }
+  }
+
 }}}
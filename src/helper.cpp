@@ -37,6 +37,59 @@ StringMap sliceToStringMap(VSlice const& slice){
   return rv;
 }
 
+HeaderMap sliceToHeaderMap(VSlice const& slice){
+  HeaderMap rv;
+  rv.assign(slice);
+  return rv;
+}
+
+std::unique_ptr<Response> copyResponse(Response const& response) {
+  std::unique_ptr<Response> copy(new Response(MessageHeader(response.header)));
+  auto payload = response.payload();
+  VBuffer buffer;
+  buffer.append(boost::asio::buffer_cast<uint8_t const*>(payload), boost::asio::buffer_size(payload));
+  copy->setPayload(std::move(buffer), 0);
+  return copy;
+}
+
+std::string requestIdentity(Request const& request) {
+  auto const& header = request.header;
+  RestVerb verb = header.restVerb ? header.restVerb.get() : RestVerb::Get;
+  if ((verb != RestVerb::Get && verb != RestVerb::Head) ||
+      boost::asio::buffer_size(request.payload()) > 0 ||
+      request.bodySource() || request.responseDataCallback()) {
+    return std::string();
+  }
+
+  // every field is prefixed with its length, so no content of one field
+  // can be mistaken for the boundary to the next
+  std::string key;
+  auto field = [&key](std::string const& value) {
+    key.append(std::to_string(value.size())).push_back(':');
+    key.append(value);
+  };
+  field(to_string(verb));
+  field(header.database ? header.database.get() : "");
+  field(header.path ? header.path.get() : "");
+  StringMap const none;
+  auto const& parameters = header.parameters ? header.parameters.get() : none;
+  key.append(std::to_string(parameters.size())).push_back('=');
+  for (auto const& param : parameters) {
+    field(param.first);
+    field(param.second);
+  }
+  auto meta = header.meta.toStringMap();
+  key.append(std::to_string(meta.size())).push_back('=');
+  for (auto const& m : meta) {
+    field(m.first);
+    field(m.second);
+  }
+  field(header.user ? header.user.get() : "");
+  field(header.password ? header.password.get() : "");
+  field(header.token ? header.token.get() : "");
+  return key;
+}
+
 std::string to_string(VSlice const& slice){
   std::stringstream ss;
   try {
@@ -98,47 +151,55 @@ static inline int hex2int(char ch, int errorValue = 0) {
 }
 
 
-std::string urlEncode(char const* src, size_t const len) {
+namespace {
+// urlSafeChars marks all characters that urlEncode passes through unchanged.
+struct UrlSafeChars {
+  UrlSafeChars() {
+    memset(safe, 0, sizeof(safe));
+    for (int c = '0'; c <= '9'; ++c) { safe[c] = true; }
+    for (int c = 'a'; c <= 'z'; ++c) { safe[c] = true; }
+    for (int c = 'A'; c <= 'Z'; ++c) { safe[c] = true; }
+    safe['-'] = safe['_'] = safe['~'] = true;
+  }
+  bool safe[256];
+};
+UrlSafeChars const urlSafeChars;
+}
+
+void urlEncode(std::string& out, char const* src, size_t const len) {
   static char hexChars[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
                               '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
 
-  char const* end = src + len;
-
   if (len >= (SIZE_MAX - 1) / 3) {
     throw std::overflow_error("out of memory");
   }
 
-  std::string result;
-  result.reserve(3 * len);
-
-  for (; src < end; ++src) {
-    if ('0' <= *src && *src <= '9') {
-      result.push_back(*src);
-    }
-
-    else if ('a' <= *src && *src <= 'z') {
-      result.push_back(*src);
-    }
-
-    else if ('A' <= *src && *src <= 'Z') {
-      result.push_back(*src);
+  char const* end = src + len;
+  while (src < end) {
+    // copy runs of safe characters in one go, in the common case that is
+    // the whole input.
+    char const* run = src;
+    while (src < end && urlSafeChars.safe[(uint8_t)*src]) {
+      ++src;
     }
-
-    else if (*src == '-' || *src == '_' || *src == '~') {
-      result.push_back(*src);
+    if (src != run) {
+      out.append(run, src - run);
+      if (src == end) {
+        break;
+      }
     }
 
-    else {
-      uint8_t n = (uint8_t)(*src);
-      uint8_t n1 = n >> 4;
-      uint8_t n2 = n & 0x0F;
-
-      result.push_back('%');
-      result.push_back(hexChars[n1]);
-      result.push_back(hexChars[n2]);
-    }
+    uint8_t n = (uint8_t)(*src);
+    char escaped[3] = {'%', hexChars[n >> 4], hexChars[n & 0x0F]};
+    out.append(escaped, 3);
+    ++src;
   }
+}
 
+std::string urlEncode(char const* src, size_t const len) {
+  std::string result;
+  result.reserve(len + (len >> 2) + 8);
+  urlEncode(result, src, len);
   return result;
 }
 
@@ -0,0 +1,419 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/algorithm/string.hpp>
+
+#include <fuerte/helper.h>
+
+#include "http.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace http {
+
+// Lines (status line, headers, chunk sizes) longer than this are rejected.
+static std::size_t const maxLineLength = 64 * 1024;
+
+// methodName returns the HTTP method token for the given verb (e.g. "GET").
+char const* methodName(RestVerb verb) {
+  switch (verb) {
+    case RestVerb::Delete:
+      return "DELETE";
+    case RestVerb::Get:
+      return "GET";
+    case RestVerb::Post:
+      return "POST";
+    case RestVerb::Put:
+      return "PUT";
+    case RestVerb::Head:
+      return "HEAD";
+    case RestVerb::Patch:
+      return "PATCH";
+    case RestVerb::Options:
+      return "OPTIONS";
+    case RestVerb::Illegal:
+      break;
+  }
+  throw std::runtime_error("Invalid request type " + to_string(verb));
+}
+
+// basicAuthorization returns the value of an Authorization header that
+// authenticates the given user with HTTP basic authentication.
+std::string basicAuthorization(std::string const& user, std::string const& password) {
+  static char const* base64Chars =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  std::string const in = user + ":" + password;
+  std::string out("Basic ");
+  out.reserve(out.size() + ((in.size() + 2) / 3) * 4);
+
+  std::size_t i = 0;
+  for (; i + 2 < in.size(); i += 3) {
+    uint32_t n = (uint8_t(in[i]) << 16) | (uint8_t(in[i + 1]) << 8) | uint8_t(in[i + 2]);
+    out.push_back(base64Chars[(n >> 18) & 0x3F]);
+    out.push_back(base64Chars[(n >> 12) & 0x3F]);
+    out.push_back(base64Chars[(n >> 6) & 0x3F]);
+    out.push_back(base64Chars[n & 0x3F]);
+  }
+  if (i + 1 == in.size()) {
+    uint32_t n = uint8_t(in[i]) << 16;
+    out.push_back(base64Chars[(n >> 18) & 0x3F]);
+    out.push_back(base64Chars[(n >> 12) & 0x3F]);
+    out.append("==");
+  } else if (i + 2 == in.size()) {
+    uint32_t n = (uint8_t(in[i]) << 16) | (uint8_t(in[i + 1]) << 8);
+    out.push_back(base64Chars[(n >> 18) & 0x3F]);
+    out.push_back(base64Chars[(n >> 12) & 0x3F]);
+    out.push_back(base64Chars[(n >> 6) & 0x3F]);
+    out.push_back('=');
+  }
+  return out;
+}
+
+// appendRequestTarget appends the request target ("/_db/<database><path>?<parameters>")
+// of the given header to the given string.
+void appendRequestTarget(std::string& out, MessageHeader const& header) {
+  if (header.database) {
+    out.append("/_db/");
+    out.append(header.database.get());
+  }
+  if (header.path && !header.path.get().empty()) {
+    out.append(header.path.get());
+  } else if (!header.database) {
+    out.push_back('/');
+  }
+
+  if (header.parameters) {
+    char sep = '?';
+    for (auto const& p : header.parameters.get()) {
+      out.push_back(sep);
+      urlEncode(out, p.first);
+      out.push_back('=');
+      urlEncode(out, p.second);
+      sep = '&';
+    }
+  }
+}
+
+// appendRequestHead appends the HTTP/1.1 request line and all headers of the
+// given request to the given string, including the empty line that terminates
+// the header block.
+void appendRequestHead(std::string& out, Request const& request,
+                       std::string const& host, std::string const& authorization) {
+  auto const& header = request.header;
+  auto const& bodySource = request.bodySource();
+  auto verb = header.restVerb ? header.restVerb.get() : RestVerb::Illegal;
+
+  out.append(methodName(verb));
+  out.push_back(' ');
+  appendRequestTarget(out, header);
+  out.append(" HTTP/1.1\r\nHost: ");
+  out.append(host);
+  out.append("\r\n");
+
+  if (!authorization.empty()) {
+    out.append("Authorization: ");
+    out.append(authorization);
+    out.append("\r\n");
+  }
+
+  for (auto const& m : header.meta) {
+    // the length is always taken from the payload
+    if (m.first == "content-length" || (bodySource && m.first == "transfer-encoding")) {
+      continue;
+    }
+    out.append(m.first.data(), m.first.size());
+    out.append(": ");
+    out.append(m.second.data(), m.second.size());
+    out.append("\r\n");
+  }
+
+  if (bodySource && !bodySource->size()) {
+    // the length of the body is not known before it has been sent
+    out.append("Transfer-Encoding: chunked\r\n\r\n");
+    return;
+  }
+
+  auto length = bodySource ? bodySource->size().get()
+                           : boost::asio::buffer_size(request.payload());
+  if (length > 0 || verb == RestVerb::Post || verb == RestVerb::Put || verb == RestVerb::Patch) {
+    out.append("Content-Length: ");
+    out.append(std::to_string(length));
+    out.append("\r\n");
+  }
+  out.append("\r\n");
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// ResponseParser
+/////////////////////////////////////////////////////////////////////////////////////
+
+void ResponseParser::reset(bool headRequest, ResponseDataCallback dataCallback) {
+  _state = State::StatusLine;
+  _headRequest = headRequest;
+  _started = false;
+  _keepAlive = true;
+  _untilClose = false;
+  _remaining = 0;
+  _statusCode = 0;
+  _line.clear();
+  _headers.clear();
+  _body.clear();
+  _dataCallback = std::move(dataCallback);
+}
+
+std::size_t ResponseParser::feed(uint8_t const* data, std::size_t length) {
+  uint8_t const* cursor = data;
+  uint8_t const* end = data + length;
+  if (length > 0) {
+    _started = true;
+  }
+
+  while (cursor < end && _state != State::Done) {
+    switch (_state) {
+      case State::StatusLine:
+        if (readLine(cursor, end)) {
+          // tolerate empty lines in front of a response
+          if (!_line.empty()) {
+            parseStatusLine();
+            _state = State::Header;
+          }
+          _line.clear();
+        }
+        break;
+
+      case State::Header:
+        if (readLine(cursor, end)) {
+          if (_line.empty()) {
+            headerComplete();
+          } else {
+            parseHeaderLine();
+          }
+          _line.clear();
+        }
+        break;
+
+      case State::Body:
+      case State::ChunkData:
+        readBody(cursor, end);
+        break;
+
+      case State::ChunkSize:
+        if (readLine(cursor, end)) {
+          auto sizeEnd = _line.find(';'); // ignore chunk extensions
+          std::string size = _line.substr(0, sizeEnd);
+          boost::trim(size);
+          if (size.empty() || size.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+            throw std::runtime_error("invalid chunk size in HTTP response");
+          }
+          _remaining = std::stoull(size, nullptr, 16);
+          _state = (_remaining == 0) ? State::Trailer : State::ChunkData;
+          _line.clear();
+        }
+        break;
+
+      case State::ChunkEnd:
+        if (readLine(cursor, end)) {
+          if (!_line.empty()) {
+            throw std::runtime_error("missing chunk terminator in HTTP response");
+          }
+          _state = State::ChunkSize;
+          _line.clear();
+        }
+        break;
+
+      case State::Trailer:
+        // trailing headers are ignored
+        if (readLine(cursor, end)) {
+          if (_line.empty()) {
+            _state = State::Done;
+          }
+          _line.clear();
+        }
+        break;
+
+      case State::Done:
+        break;
+    }
+  }
+
+  return cursor - data;
+}
+
+bool ResponseParser::finish() {
+  if (_state == State::Body && _untilClose) {
+    _state = State::Done;
+  }
+  _keepAlive = false;
+  return done();
+}
+
+std::unique_ptr<Response> ResponseParser::takeResponse() {
+  assert(done());
+  std::unique_ptr<Response> response(new Response());
+  response->header.responseCode = _statusCode;
+  if (_body.size()) {
+    _body.moveTo(*response, 0);
+  }
+  response->header.meta = std::move(_headers);
+  _headers.clear();
+  _body.clear();
+  return response;
+}
+
+bool ResponseParser::readLine(uint8_t const*& cursor, uint8_t const* end) {
+  auto lf = static_cast<uint8_t const*>(std::memchr(cursor, '\n', end - cursor));
+  auto lineEnd = (lf == nullptr) ? end : lf;
+  if (_line.size() + (lineEnd - cursor) > maxLineLength) {
+    throw std::runtime_error("HTTP response line too long");
+  }
+  _line.append(reinterpret_cast<char const*>(cursor), lineEnd - cursor);
+  if (lf == nullptr) {
+    cursor = end;
+    return false;
+  }
+  cursor = lf + 1;
+  if (!_line.empty() && _line.back() == '\r') {
+    _line.pop_back();
+  }
+  return true;
+}
+
+// parses "HTTP/1.1 200 OK"
+void ResponseParser::parseStatusLine() {
+  if (_line.compare(0, 5, "HTTP/") != 0) {
+    throw std::runtime_error("invalid HTTP status line: " + _line);
+  }
+  auto sp = _line.find(' ');
+  if (sp == std::string::npos || sp + 4 > _line.size()) {
+    throw std::runtime_error("invalid HTTP status line: " + _line);
+  }
+  // HTTP/1.0 closes the connection unless keep-alive is requested explicitly
+  _keepAlive = (_line.compare(0, sp, "HTTP/1.0") != 0);
+
+  _statusCode = 0;
+  for (std::size_t i = sp + 1; i < sp + 4; i++) {
+    char c = _line[i];
+    if (c < '0' || c > '9') {
+      throw std::runtime_error("invalid HTTP status line: " + _line);
+    }
+    _statusCode = _statusCode * 10 + (c - '0');
+  }
+}
+
+// parses "Key: value"
+void ResponseParser::parseHeaderLine() {
+  auto pivot = _line.find(':');
+  if (pivot == std::string::npos) {
+    throw std::runtime_error("invalid HTTP header line: " + _line);
+  }
+  boost::string_ref key(_line.data(), pivot);
+  boost::string_ref value(_line.data() + pivot + 1, _line.size() - pivot - 1);
+  auto isSpace = [](char c) { return c == ' ' || c == '\t'; };
+  while (!key.empty() && isSpace(key.front())) { key.remove_prefix(1); }
+  while (!key.empty() && isSpace(key.back())) { key.remove_suffix(1); }
+  while (!value.empty() && isSpace(value.front())) { value.remove_prefix(1); }
+  while (!value.empty() && isSpace(value.back())) { value.remove_suffix(1); }
+
+  if (boost::iequals(key, "content-length")) {
+    if (value.empty() || value.find_first_not_of("0123456789") != boost::string_ref::npos) {
+      throw std::runtime_error("invalid content-length in HTTP response");
+    }
+    _remaining = std::stoull(value.to_string());
+  }
+
+  if (!_headers.emplace(key, value)) {
+    // repeated headers are combined into a list
+    std::string combined = _headers.value(key).to_string();
+    combined.append(", ");
+    combined.append(value.data(), value.size());
+    _headers.set(key, combined);
+  }
+}
+
+// decides how the body of the response is delimited.
+void ResponseParser::headerComplete() {
+  if (_statusCode >= 100 && _statusCode < 200) {
+    // interim response (e.g. 100 Continue), the real one follows
+    _headers.clear();
+    _remaining = 0;
+    _state = State::StatusLine;
+    return;
+  }
+
+  auto connection = _headers.value(HeaderKey::Connection);
+  if (boost::ifind_first(connection, "close")) {
+    _keepAlive = false;
+  } else if (boost::ifind_first(connection, "keep-alive")) {
+    _keepAlive = true;
+  }
+
+  if (_headRequest || _statusCode == 204 || _statusCode == 304) {
+    _remaining = 0;
+    _state = State::Done;
+    return;
+  }
+
+  auto encoding = _headers.value(HeaderKey::TransferEncoding);
+  if (boost::ifind_first(encoding, "chunked")) {
+    _remaining = 0;
+    _state = State::ChunkSize;
+    return;
+  }
+
+  if (_headers.contains(HeaderKey::ContentLength)) {
+    if (!_dataCallback) {
+      _body.reserve(_remaining);
+    }
+    _state = (_remaining == 0) ? State::Done : State::Body;
+    return;
+  }
+
+  // no length given, the body ends when the server closes the connection
+  _untilClose = true;
+  _keepAlive = false;
+  _remaining = std::numeric_limits<uint64_t>::max();
+  _state = State::Body;
+}
+
+void ResponseParser::readBody(uint8_t const*& cursor, uint8_t const* end) {
+  uint64_t available = end - cursor;
+  auto n = std::min(available, _remaining);
+  if (_dataCallback) {
+    if (n > 0) {
+      _dataCallback(_statusCode, cursor, n);
+    }
+  } else {
+    _body.append(cursor, n);
+  }
+  cursor += n;
+  if (!_untilClose) {
+    _remaining -= n;
+  }
+  if (_remaining == 0) {
+    _state = (_state == State::ChunkData) ? State::ChunkEnd : State::Done;
+  }
+}
+
+}}}}
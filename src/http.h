@@ -0,0 +1,130 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#ifndef ARANGO_CXX_DRIVER_HTTP
+#define ARANGO_CXX_DRIVER_HTTP
+
+#include <string>
+#include <memory>
+
+#include <fuerte/message.h>
+#include <fuerte/types.h>
+
+#include "SpillBuffer.h"
+
+namespace arangodb { namespace fuerte { inline namespace v1 { namespace http {
+
+/////////////////////////////////////////////////////////////////////////////////////
+// send http
+/////////////////////////////////////////////////////////////////////////////////////
+
+// methodName returns the HTTP method token for the given verb (e.g. "GET").
+char const* methodName(RestVerb verb);
+
+// basicAuthorization returns the value of an Authorization header that
+// authenticates the given user with HTTP basic authentication.
+std::string basicAuthorization(std::string const& user, std::string const& password);
+
+// appendRequestTarget appends the request target ("/_db/<database><path>?<parameters>")
+// of the given header to the given string.
+void appendRequestTarget(std::string& out, MessageHeader const& header);
+
+// appendRequestHead appends the HTTP/1.1 request line and all headers of the
+// given request to the given string, including the empty line that terminates
+// the header block. The payload is not appended.
+// The body of a request with a body source of unknown size is announced with
+// chunked transfer encoding.
+// An Authorization header is only added when the given authorization is not empty.
+void appendRequestHead(std::string& out, Request const& request,
+                       std::string const& host, std::string const& authorization);
+
+/////////////////////////////////////////////////////////////////////////////////////
+// receive http
+/////////////////////////////////////////////////////////////////////////////////////
+
+// ResponseParser incrementally parses HTTP/1.1 responses from a byte stream.
+// Bodies may be delimited by Content-Length, chunked transfer encoding or the
+// connection being closed. Header names are stored in lowercase.
+class ResponseParser {
+ public:
+  ResponseParser() { reset(false); }
+
+  // reset prepares the parser for the next response.
+  // Responses to HEAD requests never carry a body.
+  // When a data callback is given, the body is passed to it instead of
+  // being buffered in the response.
+  void reset(bool headRequest, ResponseDataCallback dataCallback = nullptr);
+
+  // configureBody sets when a body is kept in a temporary file instead of
+  // in memory (see ConnectionBuilder::responseSpillThreshold).
+  void configureBody(detail::ConnectionConfiguration const& configuration) {
+    _body.configure(configuration);
+  }
+
+  // feed parses the given data until the current response is complete and
+  // returns the number of bytes consumed. Bytes of a following (pipelined)
+  // response are left untouched.
+  // Throws std::runtime_error when the data is not a valid HTTP response.
+  std::size_t feed(uint8_t const* data, std::size_t length);
+
+  // finish must be called when the peer closed the connection.
+  // Returns true when this completed the current response.
+  bool finish();
+
+  // done returns true when a complete response has been parsed.
+  inline bool done() const { return _state == State::Done; }
+  // started returns true when any data of the current response has been consumed.
+  inline bool started() const { return _started; }
+  // keepAlive returns true when the connection can be reused after the current response.
+  inline bool keepAlive() const { return _keepAlive; }
+
+  // takeResponse moves the parsed response out of the parser.
+  // Only valid when done() returns true.
+  std::unique_ptr<Response> takeResponse();
+
+ private:
+  enum class State { StatusLine, Header, Body, ChunkSize, ChunkData, ChunkEnd, Trailer, Done };
+
+  // readLine collects data up to the next line feed.
+  // Returns true when a complete line is available in _line.
+  bool readLine(uint8_t const*& cursor, uint8_t const* end);
+  void parseStatusLine();
+  void parseHeaderLine();
+  void headerComplete();
+  void readBody(uint8_t const*& cursor, uint8_t const* end);
+
+ private:
+  State _state;
+  bool _headRequest;
+  bool _started;
+  bool _keepAlive;
+  bool _untilClose;         // body is delimited by the connection being closed
+  uint64_t _remaining;      // bytes left in the body or current chunk
+  StatusCode _statusCode;
+  std::string _line;        // (partial) line that is being read
+  HeaderMap _headers;
+  SpillBuffer _body;
+  ResponseDataCallback _dataCallback;
+};
+
+}}}}
+#endif
@@ -0,0 +1,199 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#include <fuerte/connection.h>
+#include <fuerte/importer.h>
+#include <fuerte/requests.h>
+
+namespace arangodb { namespace fuerte { inline namespace v1 {
+
+Importer::Importer(std::string const& database, std::string const& collection,
+                   ImportOptions const& options)
+  : _database(database)
+  , _collection(collection)
+  , _options(options)
+  , _documentCount(0)
+  , _documentBytes(0)
+  , _jsonCount(0)
+  , _inFlight(options.connections.size(), 0)
+  , _totalInFlight(0)
+  {
+    if (_options.maxInFlight == 0) {
+      _options.maxInFlight = 1;
+    }
+  }
+
+Importer::~Importer() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _condition.wait(lock, [this] { return _totalInFlight == 0; });
+}
+
+void Importer::add(VSlice const& document) {
+  if (!_documents) {
+    _documents.reset(new VBuilder());
+    _documents->openArray();
+  }
+  _documents->add(document);
+  _documentCount++;
+  // the builder is still open, its size is not known yet
+  _documentBytes += document.byteSize();
+  if (_documentBytes >= _options.batchBytes) {
+    sendDocuments();
+  }
+}
+
+void Importer::addJson(std::string const& json) {
+  _json.append(reinterpret_cast<uint8_t const*>(json.data()), json.size());
+  _json.push_back('\n');
+  _jsonCount++;
+  if (_json.byteSize() >= _options.batchBytes) {
+    sendJson();
+  }
+}
+
+void Importer::addJsonLines(std::istream& in) {
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+    addJson(line);
+  }
+}
+
+ImportResult Importer::finish() {
+  sendDocuments();
+  sendJson();
+  std::unique_lock<std::mutex> lock(_mutex);
+  _condition.wait(lock, [this] { return _totalInFlight == 0; });
+  return _result;
+}
+
+void Importer::sendDocuments() {
+  if (_documentCount == 0) {
+    return;
+  }
+  _documents->close();
+  StringMap parameters;
+  parameters.emplace("collection", _collection);
+  parameters.emplace("type", "list");
+  auto request = createRequest(RestVerb::Post, "/_api/import", parameters, std::move(*_documents->steal()));
+  _documents.reset();
+  auto count = _documentCount;
+  _documentCount = 0;
+  _documentBytes = 0;
+  send(std::move(request), count);
+}
+
+void Importer::sendJson() {
+  if (_jsonCount == 0) {
+    return;
+  }
+  StringMap parameters;
+  parameters.emplace("collection", _collection);
+  parameters.emplace("type", "documents");
+  auto request = createRequest(RestVerb::Post, ContentType::Json);
+  request->header.path = "/_api/import";
+  request->header.parameters = parameters;
+  request->addBinarySingle(std::move(_json));
+  _json.clear();
+  auto count = _jsonCount;
+  _jsonCount = 0;
+  send(std::move(request), count);
+}
+
+void Importer::send(std::unique_ptr<Request> request, std::size_t documents) {
+  request->header.database = _database;
+
+  std::size_t connection = 0;
+  {
+    // wait for a free slot and take the least busy connection
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto limit = _options.maxInFlight * _inFlight.size();
+    _condition.wait(lock, [this, limit] { return _totalInFlight < limit; });
+    for (std::size_t i = 1; i < _inFlight.size(); i++) {
+      if (_inFlight[i] < _inFlight[connection]) {
+        connection = i;
+      }
+    }
+    _inFlight[connection]++;
+    _totalInFlight++;
+  }
+
+  // the destructor waits for all batches, so this stays valid
+  try {
+    _options.connections[connection]->sendRequest(std::move(request),
+        [this, connection, documents](Error error, std::unique_ptr<Request>, std::unique_ptr<Response> response) {
+      received(connection, documents, error, std::move(response));
+    });
+  } catch (std::exception const&) {
+    // the batch was not sent, it fails and frees its slot
+    received(connection, documents, errorToInt(ErrorCondition::ConnectionError), nullptr);
+  }
+}
+
+void Importer::received(std::size_t connection, std::size_t documents,
+                        Error error, std::unique_ptr<Response> response) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (error != 0 || !response) {
+      _result.failed += documents;
+      if (_result.error == 0) {
+        _result.error = error != 0 ? error : errorToInt(ErrorCondition::ConnectionError);
+      }
+    } else {
+      try {
+        auto const& slices = response->slices();
+        VSlice slice = slices.empty() ? VSlice() : slices.front();
+        auto count = [&slice](char const* name) -> std::size_t {
+          auto value = slice.get(name);
+          return value.isNumber() ? value.getNumber<std::size_t>() : 0;
+        };
+        if (response->statusCode() >= 400 || !slice.isObject()) {
+          _result.errors += documents;
+          if (_result.errorMessage.empty()) {
+            auto message = slice.isObject() ? slice.get("errorMessage") : VSlice();
+            _result.errorMessage = message.isString() ? message.copyString()
+                                                      : "invalid status " + std::to_string(response->statusCode());
+          }
+        } else {
+          _result.created += count("created");
+          _result.errors += count("errors");
+          _result.empty += count("empty");
+          _result.updated += count("updated");
+          _result.ignored += count("ignored");
+        }
+      } catch (std::exception const& e) {
+        _result.errors += documents;
+        if (_result.errorMessage.empty()) {
+          _result.errorMessage = e.what();
+        }
+      }
+    }
+    _inFlight[connection]--;
+    _totalInFlight--;
+    // notify under the lock, the destructor may run as soon as it is released
+    _condition.notify_all();
+  }
+}
+
+}}}
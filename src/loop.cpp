@@ -29,6 +29,7 @@
 #include <fuerte/loop.h>
 #include <fuerte/types.h>
 
+#include "CurlShare.h"
 #include "VpackInit.h"
 
 namespace arangodb { namespace fuerte { inline namespace v1 {
@@ -59,4 +60,14 @@ void EventLoopService::run() {
   }
 }
 
+// curlShare returns the curl share used by all HTTP connections of this
+// service that opted in. Created on first use.
+std::shared_ptr<http::CurlShare> EventLoopService::curlShare() {
+  std::lock_guard<std::mutex> lock(curl_share_mutex_);
+  if (!curl_share_) {
+    curl_share_ = std::make_shared<http::CurlShare>(*io_service_);
+  }
+  return curl_share_;
+}
+
 }}}
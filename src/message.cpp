@@ -21,9 +21,16 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <fuerte/message.h>
+#include <velocypack/Iterator.h>
 #include <velocypack/Validator.h>
+#include <fstream>
 #include <sstream>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "vst.h"
 
 namespace arangodb { namespace fuerte { inline namespace v1 {
@@ -36,7 +43,7 @@ std::string to_string(MessageHeader const& header){
   ::boost::optional<RestVerb> restVerb;           // GET POST ...
   ::boost::optional<std::string> path;            // equivalent of http path
   ::boost::optional<StringMap> parameters;        // equivalent of http parametes ?foo=bar
-  ::boost::optional<StringMap> meta;              // equivalent of http headers
+  HeaderMap meta;                                 // equivalent of http headers
   ::boost::optional<std::string> user;
   ::boost::optional<std::string> password;*/
   std::stringstream ss;
@@ -77,9 +84,9 @@ std::string to_string(MessageHeader const& header){
     ss<< std::endl;
   }
 
-  if(header.meta){
+  if(!header.meta.empty()){
     ss << "meta:\n";
-    for(auto const& item : header.meta.get()){
+    for(auto const& item : header.meta){
       ss << "\t" << item.first <<  " -:- " << item.second << "\n";
     }
     ss<< std::endl;
@@ -98,21 +105,304 @@ std::string to_string(MessageHeader const& header){
   return ss.str();
 }
 
+///////////////////////////////////////////////
+// class HeaderMap
+///////////////////////////////////////////////
+
+namespace {
+// identify returns the id of the given lower case key.
+HeaderKey identify(boost::string_ref key) {
+  switch (key.size()) {
+    case 6:
+      return key == "accept" ? HeaderKey::Accept : HeaderKey::Other;
+    case 10:
+      return key == "connection" ? HeaderKey::Connection : HeaderKey::Other;
+    case 12:
+      return key == "content-type" ? HeaderKey::ContentType : HeaderKey::Other;
+    case 13:
+      return key == "authorization" ? HeaderKey::Authorization : HeaderKey::Other;
+    case 14:
+      return key == "content-length" ? HeaderKey::ContentLength : HeaderKey::Other;
+    case 17:
+      return key == "transfer-encoding" ? HeaderKey::TransferEncoding : HeaderKey::Other;
+    default:
+      return HeaderKey::Other;
+  }
+}
+
+boost::string_ref keyName(HeaderKey key) {
+  switch (key) {
+    case HeaderKey::ContentType:
+      return "content-type";
+    case HeaderKey::Accept:
+      return "accept";
+    case HeaderKey::ContentLength:
+      return "content-length";
+    case HeaderKey::Authorization:
+      return "authorization";
+    case HeaderKey::Connection:
+      return "connection";
+    case HeaderKey::TransferEncoding:
+      return "transfer-encoding";
+    default:
+      return "";
+  }
+}
+
+// LowerKey holds a lower case copy of a key, on the stack for all
+// reasonable keys.
+class LowerKey {
+ public:
+  explicit LowerKey(boost::string_ref key) {
+    char* out = _local;
+    if (key.size() > sizeof(_local)) {
+      _heap.resize(key.size());
+      out = &_heap[0];
+    }
+    for (std::size_t i = 0; i < key.size(); i++) {
+      out[i] = static_cast<char>(::tolower(static_cast<unsigned char>(key[i])));
+    }
+    _key = boost::string_ref(out, key.size());
+  }
+  LowerKey(LowerKey const&) = delete;
+  LowerKey& operator=(LowerKey const&) = delete;
+
+  boost::string_ref get() const { return _key; }
+
+ private:
+  char _local[64];
+  std::string _heap;
+  boost::string_ref _key;
+};
+}
+
+HeaderMap::HeaderMap(StringMap const& map)
+    : _contentType(ContentType::Unset), _acceptType(ContentType::Unset), _lazy(nullptr) {
+  std::size_t bytes = 0;
+  for (auto const& it : map) {
+    bytes += it.first.size() + it.second.size();
+  }
+  reserve(map.size(), bytes);
+  for (auto const& it : map) {
+    set(it.first, it.second);
+  }
+}
+
+HeaderMap::HeaderMap(HeaderMap const& other) : _lazy(nullptr) {
+  other.decode();
+  _buffer = other._buffer;
+  _fields = other._fields;
+  _contentType = other._contentType;
+  _acceptType = other._acceptType;
+}
+
+HeaderMap::HeaderMap(HeaderMap&& other) : _lazy(nullptr) {
+  other.decode();
+  _buffer = std::move(other._buffer);
+  _fields = std::move(other._fields);
+  _contentType = other._contentType;
+  _acceptType = other._acceptType;
+}
+
+HeaderMap& HeaderMap::operator=(HeaderMap const& other) {
+  if (this != &other) {
+    other.decode();
+    _buffer = other._buffer;
+    _fields = other._fields;
+    _contentType = other._contentType;
+    _acceptType = other._acceptType;
+    _lazy = nullptr;
+  }
+  return *this;
+}
+
+HeaderMap& HeaderMap::operator=(HeaderMap&& other) {
+  if (this != &other) {
+    other.decode();
+    _buffer = std::move(other._buffer);
+    _fields = std::move(other._fields);
+    _contentType = other._contentType;
+    _acceptType = other._acceptType;
+    _lazy = nullptr;
+  }
+  return *this;
+}
+
+void HeaderMap::clear() {
+  _lazy = nullptr;
+  _buffer.clear();
+  _fields.clear();
+  _contentType = ContentType::Unset;
+  _acceptType = ContentType::Unset;
+}
+
+void HeaderMap::reserve(std::size_t fields, std::size_t bytes) {
+  decode();
+  _fields.reserve(fields);
+  _buffer.reserve(bytes);
+}
+
+void HeaderMap::set(boost::string_ref key, boost::string_ref value) {
+  decode();
+  LowerKey lower(key);
+  auto id = identify(lower.get());
+  auto field = find(id, lower.get());
+  if (field == nullptr) {
+    append(lower.get(), id, value);
+  } else {
+    replaceValue(const_cast<Field&>(*field), value);
+  }
+}
+
+bool HeaderMap::emplace(boost::string_ref key, boost::string_ref value) {
+  decode();
+  LowerKey lower(key);
+  auto id = identify(lower.get());
+  if (find(id, lower.get()) != nullptr) {
+    return false;
+  }
+  append(lower.get(), id, value);
+  return true;
+}
+
+bool HeaderMap::contains(boost::string_ref key) const {
+  decode();
+  LowerKey lower(key);
+  return find(identify(lower.get()), lower.get()) != nullptr;
+}
+
+bool HeaderMap::contains(HeaderKey key) const {
+  decode();
+  return find(key, keyName(key)) != nullptr;
+}
+
+boost::string_ref HeaderMap::value(boost::string_ref key) const {
+  decode();
+  LowerKey lower(key);
+  auto field = find(identify(lower.get()), lower.get());
+  if (field == nullptr) {
+    return boost::string_ref();
+  }
+  return boost::string_ref(_buffer.data() + field->value, field->valueLength);
+}
+
+boost::string_ref HeaderMap::value(HeaderKey key) const {
+  decode();
+  auto field = find(key, keyName(key));
+  if (field == nullptr) {
+    return boost::string_ref();
+  }
+  return boost::string_ref(_buffer.data() + field->value, field->valueLength);
+}
+
+HeaderMap::value_type HeaderMap::at(std::size_t pos) const {
+  decode();
+  auto const& field = _fields[pos];
+  return value_type(boost::string_ref(_buffer.data() + field.key, field.keyLength),
+                    boost::string_ref(_buffer.data() + field.value, field.valueLength));
+}
+
+StringMap HeaderMap::toStringMap() const {
+  decode();
+  StringMap map;
+  for (auto const& it : *this) {
+    map.emplace(it.first.to_string(), it.second.to_string());
+  }
+  return map;
+}
+
+void HeaderMap::assign(VSlice const& object) {
+  clear();
+  assert(object.isObject());
+  reserve(object.length(), object.byteSize());
+  for (auto const& it : ::arangodb::velocypack::ObjectIterator(object)) {
+    if (!it.value.isString()) {
+      // meta data consists of strings only
+      continue;
+    }
+    ::arangodb::velocypack::ValueLength keyLength, valueLength;
+    char const* key = it.key.getString(keyLength);
+    char const* value = it.value.getString(valueLength);
+    set(boost::string_ref(key, keyLength), boost::string_ref(value, valueLength));
+  }
+}
+
+void HeaderMap::assignLazy(VSlice const& object) {
+  clear();
+  assert(object.isObject());
+  _lazy = object.start();
+}
+
+void HeaderMap::decodeLazy() {
+  VSlice object(_lazy);
+  _lazy = nullptr;
+  assign(object);
+}
+
+// find returns the field with the given key, well known keys are only
+// compared by their id.
+HeaderMap::Field const* HeaderMap::find(HeaderKey id, boost::string_ref lowerKey) const {
+  for (auto const& field : _fields) {
+    if (field.id != id) {
+      continue;
+    }
+    if (id != HeaderKey::Other ||
+        boost::string_ref(_buffer.data() + field.key, field.keyLength) == lowerKey) {
+      return &field;
+    }
+  }
+  return nullptr;
+}
+
+void HeaderMap::append(boost::string_ref key, HeaderKey id, boost::string_ref value) {
+  Field field;
+  field.id = id;
+  field.key = static_cast<uint32_t>(_buffer.size());
+  field.keyLength = static_cast<uint32_t>(key.size());
+  _buffer.append(key.data(), key.size());
+  field.value = static_cast<uint32_t>(_buffer.size());
+  field.valueLength = static_cast<uint32_t>(value.size());
+  _buffer.append(value.data(), value.size());
+  _fields.push_back(field);
+  fieldChanged(field);
+}
+
+void HeaderMap::replaceValue(Field& field, boost::string_ref value) {
+  if (value.size() <= field.valueLength) {
+    // overwrite in place
+    std::copy(value.begin(), value.end(), &_buffer[field.value]);
+  } else {
+    // the old value stays in the buffer until the map is cleared
+    field.value = static_cast<uint32_t>(_buffer.size());
+    _buffer.append(value.data(), value.size());
+  }
+  field.valueLength = static_cast<uint32_t>(value.size());
+  fieldChanged(field);
+}
+
+void HeaderMap::fieldChanged(Field const& field) {
+  if (field.id == HeaderKey::ContentType) {
+    _contentType = to_ContentType(_buffer.data() + field.value, field.valueLength);
+  } else if (field.id == HeaderKey::Accept) {
+    _acceptType = to_ContentType(_buffer.data() + field.value, field.valueLength);
+  }
+}
+
 ///////////////////////////////////////////////
 // class MessageHeader
 ///////////////////////////////////////////////
 
 // content type accessors
 std::string MessageHeader::contentTypeString() const {
-  return metaByKey(fu_content_type_key);
+  return meta.value(HeaderKey::ContentType).to_string();
 }
 
 ContentType MessageHeader::contentType() const {
-  return to_ContentType(contentTypeString());
+  return meta.contentType();
 }
 
 void MessageHeader::contentType(std::string const& type) {
-  addMeta(fu_content_type_key, type);
+  meta.set(fu_content_type_key, type);
 }
 
 void MessageHeader::contentType(ContentType type){
@@ -121,15 +411,15 @@ void MessageHeader::contentType(ContentType type){
 
 // accept header accessors
 std::string MessageHeader::acceptTypeString() const {
-  return metaByKey(fu_accept_key);
+  return meta.value(HeaderKey::Accept).to_string();
 }
 
 ContentType MessageHeader::acceptType() const {
-  return to_ContentType(acceptTypeString());
+  return meta.acceptType();
 }
 
 void MessageHeader::acceptType(std::string const& type) {
-  addMeta(fu_accept_key, type);
+  meta.set(fu_accept_key, type);
 }
 
 void MessageHeader::acceptType(ContentType type){
@@ -144,20 +434,12 @@ void MessageHeader::addParameter(std::string const& key, std::string const& valu
 }
 
 void MessageHeader::addMeta(std::string const& key, std::string const& value) {
-  if (!meta) {
-    meta = StringMap();
-  }
-  meta.get()[key] = value;
+  meta.set(key, value);
 }
 
 // Get value for header metadata key, returns empty string if not found.
 std::string MessageHeader::metaByKey(std::string const& key) const {
-  if (!meta) {
-    return "";
-  }
-  auto& hmap = meta.get();
-  auto found =  hmap.find(key);
-  return (found == hmap.end()) ? "" : found->second;
+  return meta.value(key).to_string();
 }
 
 ///////////////////////////////////////////////
@@ -190,6 +472,127 @@ ContentType Message::acceptType() const {
   return header.acceptType();
 }
 
+///////////////////////////////////////////////
+// class MappedFile
+///////////////////////////////////////////////
+
+MappedFile::MappedFile(std::string const& path, std::size_t offset,
+                       ::boost::optional<std::size_t> length)
+  : _mapping(nullptr), _mappingLength(0), _data(nullptr), _size(0) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("cannot open file '" + path + "'");
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error("cannot stat file '" + path + "'");
+  }
+  std::size_t fileSize = static_cast<std::size_t>(st.st_size);
+  if (offset > fileSize || (length && length.get() > fileSize - offset)) {
+    ::close(fd);
+    throw std::out_of_range("region does not fit into file '" + path + "'");
+  }
+  _size = length ? length.get() : fileSize - offset;
+  try {
+    map(fd, offset, path);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+}
+
+MappedFile::MappedFile(int fd, std::size_t offset, std::size_t length)
+  : _mapping(nullptr), _mappingLength(0), _data(nullptr), _size(length) {
+  map(fd, offset, "fd " + std::to_string(fd));
+}
+
+// map maps _size bytes of the given file, starting at offset.
+void MappedFile::map(int fd, std::size_t offset, std::string const& name) {
+  if (_size == 0) {
+    return;
+  }
+
+  // mappings start at a page boundary
+  std::size_t pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  std::size_t mappingOffset = offset - (offset % pageSize);
+  _mappingLength = _size + (offset - mappingOffset);
+  _mapping = ::mmap(nullptr, _mappingLength, PROT_READ, MAP_PRIVATE, fd,
+                    static_cast<off_t>(mappingOffset));
+  if (_mapping == MAP_FAILED) {
+    _mapping = nullptr;
+    throw std::runtime_error("cannot map file '" + name + "'");
+  }
+  // the file is read front to back
+  ::madvise(_mapping, _mappingLength, MADV_SEQUENTIAL);
+  _data = static_cast<uint8_t const*>(_mapping) + (offset - mappingOffset);
+}
+
+MappedFile::~MappedFile() {
+  if (_mapping != nullptr) {
+    ::munmap(_mapping, _mappingLength);
+  }
+}
+
+///////////////////////////////////////////////
+// class RequestBodySource
+///////////////////////////////////////////////
+
+namespace {
+// ReaderBodySource pulls the body from a RequestBodyReader.
+class ReaderBodySource : public RequestBodySource {
+public:
+  ReaderBodySource(RequestBodyReader&& reader, ::boost::optional<std::size_t> size)
+    : _reader(std::move(reader)), _size(size) {}
+
+  std::size_t read(uint8_t* buffer, std::size_t length) override {
+    return _reader(buffer, length);
+  }
+  ::boost::optional<std::size_t> size() const override { return _size; }
+
+private:
+  RequestBodyReader _reader;
+  ::boost::optional<std::size_t> _size;
+};
+
+// FileBodySource reads the body from a file.
+class FileBodySource : public RequestBodySource {
+public:
+  explicit FileBodySource(std::string const& path)
+    : _file(path, std::ios::in | std::ios::binary) {
+    if (!_file) {
+      throw std::runtime_error("cannot open request body file '" + path + "'");
+    }
+    _file.seekg(0, std::ios::end);
+    _size = static_cast<std::size_t>(_file.tellg());
+    _file.seekg(0, std::ios::beg);
+  }
+
+  std::size_t read(uint8_t* buffer, std::size_t length) override {
+    _file.read(reinterpret_cast<char*>(buffer), length);
+    if (_file.bad()) {
+      throw std::runtime_error("cannot read request body file");
+    }
+    return static_cast<std::size_t>(_file.gcount());
+  }
+  ::boost::optional<std::size_t> size() const override { return _size; }
+
+private:
+  std::ifstream _file;
+  std::size_t _size;
+};
+}
+
+std::shared_ptr<RequestBodySource> bodySourceFromReader(RequestBodyReader reader,
+                                                        ::boost::optional<std::size_t> size) {
+  return std::make_shared<ReaderBodySource>(std::move(reader), size);
+}
+
+std::shared_ptr<RequestBodySource> bodySourceFromFile(std::string const& path) {
+  return std::make_shared<FileBodySource>(path);
+}
+
 ///////////////////////////////////////////////
 // class Request
 ///////////////////////////////////////////////
@@ -297,12 +700,49 @@ void Request::addBinarySingle(VBuffer&& buffer){
   _payload.resetTo(_payloadLength);
 }
 
+// add the content of a mapped file without copying it
+void Request::addVPack(std::shared_ptr<MappedFile> file){
+#ifdef FUERTE_CHECKED_MODE
+  vst::validateAndCount(file->data(), file->size());
+#endif
+  if(_sealed || _payloadLength > 0){
+    throw std::logic_error("Message is sealed or already has a payload");
+  }
+  contentType(ContentType::VPack);
+  _isVpack = true;
+  _sealed = true;
+  _modified = true;
+  _payloadLength = file->size();
+  _mappedFile = std::move(file);
+}
+
+void Request::addBinary(std::shared_ptr<MappedFile> file){
+  if(_sealed || _payloadLength > 0){
+    throw std::logic_error("Message is sealed or already has a payload");
+  }
+  _isVpack = false;
+  _sealed = true;
+  _modified = true;
+  _payloadLength = file->size();
+  _mappedFile = std::move(file);
+}
+
+// take the body from the given source while the request is sent
+void Request::addBodySource(std::shared_ptr<RequestBodySource> source){
+  if(_sealed || _payloadLength > 0){
+    throw std::logic_error("Message is sealed or already has a payload");
+  }
+  _sealed = true;
+  _modified = true;
+  _bodySource = std::move(source);
+}
+
 // get payload as slices
 std::vector<VSlice>const & Request::slices() {
   if(_isVpack && _modified) {
     _slices.clear();
-    auto length = _payload.byteSize();
-    auto cursor = _payload.data();
+    auto length = _payloadLength;
+    auto cursor = _mappedFile ? _mappedFile->data() : _payload.data();
     while(length){
       _slices.emplace_back(cursor);
       auto sliceSize = _slices.back().byteSize();
@@ -319,6 +759,9 @@ std::vector<VSlice>const & Request::slices() {
 
 // get payload as binary
 boost::asio::const_buffer Request::payload() const {
+  if (_mappedFile) {
+    return boost::asio::const_buffer(_mappedFile->data(), _payloadLength);
+  }
   return boost::asio::const_buffer(_payload.data(), _payloadLength);
 }
 
@@ -344,8 +787,9 @@ bool Response::isContentTypeText() const {
 
 std::vector<VSlice>const & Response::slices() {
   if (_slices.empty()) {
-    auto length = _payload.byteSize() - _payloadOffset;
-    auto cursor = _payload.data() + _payloadOffset;
+    auto buffer = payload();
+    auto length = boost::asio::buffer_size(buffer);
+    auto cursor = boost::asio::buffer_cast<uint8_t const*>(buffer);
     while (length){
       _slices.emplace_back(cursor);
       auto sliceSize = _slices.back().byteSize();
@@ -360,13 +804,28 @@ std::vector<VSlice>const & Response::slices() {
 }
 
 boost::asio::const_buffer Response::payload() const {
-  return boost::asio::const_buffer(_payload.data() + _payloadOffset, _payload.byteSize());
+  if (_mappedPayload) {
+    return boost::asio::const_buffer(_mappedPayload->data() + _payloadOffset, _mappedPayload->size() - _payloadOffset);
+  }
+  return boost::asio::const_buffer(_payload.data() + _payloadOffset, _payload.byteSize() - _payloadOffset);
 }
 
 void Response::setPayload(VBuffer&& buffer, size_t payloadOffset) {
+  // the header may still point into the old buffer
+  header.meta.decode();
   _slices.clear();
   _payloadOffset = payloadOffset;
   _payload = std::move(buffer);
+  _mappedPayload.reset();
+}
+
+void Response::setPayload(std::shared_ptr<MappedFile> file, size_t payloadOffset) {
+  // the header may still point into the old buffer
+  header.meta.decode();
+  _slices.clear();
+  _payloadOffset = payloadOffset;
+  _payload.clear();
+  _mappedPayload = std::move(file);
 }
 
 }}}
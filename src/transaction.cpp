@@ -0,0 +1,263 @@
+////////////////////////////////////////////////////////////////////////////////
+/// DISCLAIMER
+///
+/// Copyright 2017 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Ewout Prangsma
+////////////////////////////////////////////////////////////////////////////////
+
+#include <fuerte/connection.h>
+#include <fuerte/requests.h>
+#include <fuerte/transaction.h>
+
+namespace arangodb { namespace fuerte { inline namespace v1 {
+
+namespace {
+std::string const trxHeader("x-arango-trx-id");
+
+void addCollections(VBuilder& builder, std::string const& name, std::vector<std::string> const& collections) {
+  if (collections.empty()) {
+    return;
+  }
+  builder.add(name, VValue(::arangodb::velocypack::ValueType::Array));
+  for (auto const& collection : collections) {
+    builder.add(VValue(collection));
+  }
+  builder.close();
+}
+}
+
+Transaction::Transaction(std::shared_ptr<Connection> conn, std::string const& database,
+                         std::size_t maxDocuments)
+  : _conn(conn)
+  , _database(database)
+  , _maxDocuments(maxDocuments)
+  , _sending(false)
+  , _finished(false)
+  , _beginFailure(0)
+  {}
+
+// Every request holds a reference, so nothing is in flight here.
+Transaction::~Transaction() {
+  if (_finished || _id.empty()) {
+    return;
+  }
+  auto request = createRequest(RestVerb::Delete, "/_api/transaction/" + _id);
+  request->header.database = _database;
+  try {
+    _conn->sendRequest(std::move(request), [](Error, std::unique_ptr<Request>, std::unique_ptr<Response>) {});
+  } catch (...) {
+    // the server aborts the transaction after its idle timeout
+  }
+}
+
+void Transaction::insert(std::string const& collection, VSlice const& document, DocumentCallback cb) {
+  add(RestVerb::Post, collection, document, std::move(cb));
+}
+
+void Transaction::update(std::string const& collection, VSlice const& document, DocumentCallback cb) {
+  add(RestVerb::Patch, collection, document, std::move(cb));
+}
+
+void Transaction::replace(std::string const& collection, VSlice const& document, DocumentCallback cb) {
+  add(RestVerb::Put, collection, document, std::move(cb));
+}
+
+void Transaction::drop(std::string const& collection, VSlice const& document, DocumentCallback cb) {
+  add(RestVerb::Delete, collection, document, std::move(cb));
+}
+
+void Transaction::commit(DocumentCallback cb) {
+  finish(Run::Commit, std::move(cb));
+}
+
+void Transaction::abort(DocumentCallback cb) {
+  finish(Run::Abort, std::move(cb));
+}
+
+std::string Transaction::id() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _id;
+}
+
+void Transaction::begin(TransactionOptions const& options) {
+  std::unique_ptr<Run> run(new Run(Run::Begin));
+  run->body.reset(new VBuilder());
+  auto& builder = *run->body;
+  builder.openObject();
+  builder.add("collections", VValue(::arangodb::velocypack::ValueType::Object));
+  addCollections(builder, "read", options.read);
+  addCollections(builder, "write", options.write);
+  addCollections(builder, "exclusive", options.exclusive);
+  builder.close();
+  builder.add("waitForSync", VValue(options.waitForSync));
+  builder.close();
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _queue.push_back(std::move(run));
+  }
+  sendNext();
+}
+
+void Transaction::add(RestVerb verb, std::string const& collection, VSlice const& document, DocumentCallback cb) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Run* run = _queue.empty() ? nullptr : _queue.back().get();
+    if (run == nullptr || run->kind != Run::Documents || run->verb != verb ||
+        run->collection != collection || run->entries >= _maxDocuments) {
+      // operations are only combined with the ones right before them
+      std::unique_ptr<Run> next(new Run(Run::Documents));
+      next->verb = verb;
+      next->collection = collection;
+      next->body.reset(new VBuilder());
+      next->body->openArray();
+      run = next.get();
+      _queue.push_back(std::move(next));
+    }
+    run->body->add(document);
+    run->entries++;
+    run->callbacks.push_back(std::move(cb));
+  }
+  sendNext();
+}
+
+void Transaction::finish(Run::Kind kind, DocumentCallback cb) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::unique_ptr<Run> run(new Run(kind));
+    run->callbacks.push_back(std::move(cb));
+    _queue.push_back(std::move(run));
+    _finished = true;
+  }
+  sendNext();
+}
+
+void Transaction::sendNext() {
+  std::vector<std::unique_ptr<Run>> failed;
+  std::shared_ptr<Run> run;
+  std::unique_ptr<Request> req;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_sending) {
+      return;
+    }
+    if (_beginFailure != 0 || _beginError) {
+      // the transaction was not started, nothing is sent anymore
+      while (!_queue.empty()) {
+        failed.push_back(std::move(_queue.front()));
+        _queue.pop_front();
+      }
+    } else if (!_queue.empty()) {
+      run.reset(_queue.front().release());
+      _queue.pop_front();
+      req = request(*run);
+      _sending = true;
+    }
+  }
+
+  // the begin error is not changed anymore
+  for (auto& f : failed) {
+    for (auto& cb : f->callbacks) {
+      cb(_beginFailure, _beginError ? _beginError->slice() : VSlice());
+    }
+  }
+  if (run) {
+    auto self = shared_from_this();
+    try {
+      _conn->sendRequest(std::move(req), [self, run](Error error, std::unique_ptr<Request>, std::unique_ptr<Response> response) {
+        self->received(run, error, std::move(response));
+      });
+    } catch (std::exception const&) {
+      // the run was not sent, it fails and the next one may go
+      received(run, errorToInt(ErrorCondition::ConnectionError), nullptr);
+    }
+  }
+}
+
+std::unique_ptr<Request> Transaction::request(Run& run) {
+  std::unique_ptr<Request> request;
+  switch (run.kind) {
+    case Run::Begin:
+      request = createRequest(RestVerb::Post, "/_api/transaction/begin", StringMap(), run.body->slice());
+      break;
+    case Run::Documents:
+      run.body->close();
+      request = createRequest(run.verb, "/_api/document/" + run.collection, StringMap(), run.body->slice());
+      request->header.addMeta(trxHeader, _id);
+      break;
+    case Run::Commit:
+      request = createRequest(RestVerb::Put, "/_api/transaction/" + _id);
+      break;
+    case Run::Abort:
+      request = createRequest(RestVerb::Delete, "/_api/transaction/" + _id);
+      break;
+  }
+  request->header.database = _database;
+  return request;
+}
+
+void Transaction::received(std::shared_ptr<Run> run, Error error, std::unique_ptr<Response> response) {
+  VSlice result;
+  if (error == 0 && !response) {
+    error = errorToInt(ErrorCondition::ConnectionError);
+  }
+  if (error == 0) {
+    try {
+      auto const& slices = response->slices();
+      if (!slices.empty()) {
+        result = slices.front();
+      }
+    } catch (std::exception const&) {
+      error = errorToInt(ErrorCondition::ErrorCastError);
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (run->kind == Run::Begin) {
+      VSlice id = result.isObject() ? result.get("result") : VSlice();
+      id = id.isObject() ? id.get("id") : VSlice();
+      if (error != 0) {
+        _beginFailure = error;
+      } else if (id.isString()) {
+        _id = id.copyString();
+      } else if (result.isNone()) {
+        _beginFailure = errorToInt(ErrorCondition::ErrorCastError);
+      } else {
+        _beginError.reset(new VBuilder());
+        _beginError->add(result);
+      }
+    }
+    _sending = false;
+  }
+  // the next run goes out before the callbacks of this one run
+  sendNext();
+
+  if (error != 0) {
+    for (auto& cb : run->callbacks) {
+      cb(error, VSlice());
+    }
+    return;
+  }
+  bool perDocument = run->kind == Run::Documents && result.isArray() && result.length() == run->entries;
+  for (std::size_t i = 0; i < run->callbacks.size(); i++) {
+    // a request that failed as a whole reports one error object for all
+    run->callbacks[i](0, perDocument ? result.at(i) : result);
+  }
+}
+
+}}}
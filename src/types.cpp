@@ -21,6 +21,8 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include <fuerte/types.h>
 
+#include <boost/utility/string_ref.hpp>
+
 namespace arangodb { namespace fuerte { inline namespace v1 {
 
 RestVerb to_RestVerb(std::string const& value) {
@@ -138,32 +140,36 @@ const std::string fu_content_type_text("text/plain");
 const std::string fu_content_type_dump("application/x-arango-dump");
 
 ContentType to_ContentType(std::string const& val) {
-  auto p = val.c_str();
+  return to_ContentType(val.data(), val.size());
+}
+
+ContentType to_ContentType(char const* data, std::size_t length) {
+  boost::string_ref val(data, length);
 
-  if (strcasecmp(p, "") == 0) {
+  if (val.empty()) {
     return ContentType::Unset;
   }
-  if (val.find(fu_content_type_unset) != std::string::npos) {
+  if (val.find(fu_content_type_unset) != boost::string_ref::npos) {
     return ContentType::Unset;
   }
 
-  if (val.find(fu_content_type_vpack) != std::string::npos) {
+  if (val.find(fu_content_type_vpack) != boost::string_ref::npos) {
     return ContentType::VPack;
   }
 
-  if (val.find(fu_content_type_json) != std::string::npos) {
+  if (val.find(fu_content_type_json) != boost::string_ref::npos) {
     return ContentType::Json;
   }
 
-  if (val.find(fu_content_type_html) != std::string::npos) {
+  if (val.find(fu_content_type_html) != boost::string_ref::npos) {
     return ContentType::Html;
   }
 
-  if (val.find(fu_content_type_text) != std::string::npos) {
+  if (val.find(fu_content_type_text) != boost::string_ref::npos) {
     return ContentType::Text;
   }
 
-  if (val.find(fu_content_type_dump) != std::string::npos) {
+  if (val.find(fu_content_type_dump) != boost::string_ref::npos) {
     return ContentType::Dump;
   }
 
@@ -223,6 +229,10 @@ ErrorCondition intToError(Error integral){
       1103, // VstWriteError
       1104, // CancelledDuringReset
       1105, // MalformedURL
+      1106, // HttpReadError
+      1107, // HttpWriteError
+      1108, // HttpProtocolError
+      1109, // VstProtocolError
       3000, // CurlError
   };
   auto pos = std::find(valid.begin(), valid.end(), integral);
@@ -259,6 +269,14 @@ std::string to_string(ErrorCondition error){
       return "Error: cancel as result of other error";
     case ErrorCondition::MalformedURL:
       return "Error: malformed URL";
+    case ErrorCondition::HttpReadError:
+      return "Error: reading http";
+    case ErrorCondition::HttpWriteError:
+      return "Error: writing http";
+    case ErrorCondition::HttpProtocolError:
+      return "Error: invalid http response";
+    case ErrorCondition::VstProtocolError:
+      return "Error: invalid vst message";
 
     case ErrorCondition::CurlError:
       return "Error: in curl";
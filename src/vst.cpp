@@ -202,10 +202,9 @@ static std::string createVstMessageHeader(MessageHeader const& header)
 
       // 6 - meta
       builder.openObject();
-      if (header.meta){
-        for(auto const& item : header.meta.get()){
-          builder.add(item.first,VValue(item.second));
-        }
+      for(auto const& item : header.meta){
+        builder.add(VPackValuePair(item.first.data(), item.first.size(), VPackValueType::String));
+        builder.add(VPackValuePair(item.second.data(), item.second.size(), VPackValueType::String));
       }
       builder.close();
 
@@ -227,7 +226,8 @@ static std::string createVstMessageHeader(MessageHeader const& header)
 
 // prepareForNetwork prepares the internal structures for writing the request 
 // to the network.
-void RequestItem::prepareForNetwork(VSTVersion vstVersion) {
+template <VSTVersion V>
+void RequestItem::prepareForNetwork() {
   // setting defaults
   _request->header.version = 1; // TODO vstVersionID;
   if(!_request->header.database){
@@ -238,27 +238,23 @@ void RequestItem::prepareForNetwork(VSTVersion vstVersion) {
   _msgHdr = createVstMessageHeader(_request->header);
 
   // Split message into chunks
-  std::vector<VSlice> slices(_request->slices());
+  std::vector<VSlice> slices;
+  if (!_request->bodySource()) {
+    slices = _request->slices();
+  }
   // Add message header slice to the front 
   slices.insert(slices.begin(), VSlice(_msgHdr.data()));
   std::vector<ChunkHeader> chunks;
   buildChunks(_messageID, defaultMaxChunkSize, slices, chunks);
+  if (_request->bodySource()) {
+    prepareBody(chunks);
+  }
 
   // Prepare request (write) buffers 
   _requestChunkBuffer.reserve(chunks.size() * maxChunkHeaderSize); // Reserve, so we don't have to re-allocate memory
   for (auto it = std::begin(chunks); it!=std::end(chunks); ++it) {
     auto chunkOffset = _requestChunkBuffer.byteSize();
-    size_t chunkHdrLen;
-    switch (vstVersion) {
-      case VST1_0:
-        chunkHdrLen = it->writeHeaderToVST1_0(_requestChunkBuffer);
-        break;
-      case VST1_1:
-        chunkHdrLen = it->writeHeaderToVST1_1(_requestChunkBuffer);
-        break;
-      default:
-        throw std::logic_error("Unknown VST version");
-    }
+    size_t chunkHdrLen = ChunkCodec<V>::writeHeader(*it, _requestChunkBuffer);
     // Add chunk buffer 
     _requestBuffers.push_back(boost::asio::const_buffer(_requestChunkBuffer.data()+chunkOffset, chunkHdrLen));
     // Add chunk data buffer 
@@ -266,6 +262,116 @@ void RequestItem::prepareForNetwork(VSTVersion vstVersion) {
   }
 }
 
+// nextBodyChunks prepares the next chunks of a streamed body for writing.
+// returns false when the entire body has been written.
+template <VSTVersion V>
+bool RequestItem::nextBodyChunks() {
+  static std::size_t const maxDataLength = defaultMaxChunkSize - maxChunkHeaderSize;
+  static std::size_t const chunksPerWrite = 8;
+
+  _requestBuffers.clear();
+  _requestChunkBuffer.clear();
+  if (_requestBodyRemaining == 0) {
+    _bodySource.reset();
+    _requestBody = std::vector<uint8_t>();
+    return false;
+  }
+
+  std::size_t length = std::min<uint64_t>(_requestBodyRemaining, chunksPerWrite * maxDataLength);
+  if (_bodySource) {
+    // read the next part of the body
+    _requestBody.resize(length);
+    _requestBodyOffset = 0;
+    std::size_t filled = 0;
+    while (filled < length) {
+      auto n = _bodySource->read(_requestBody.data() + filled, length - filled);
+      if (n == 0) {
+        throw std::runtime_error("request body is shorter than its announced size");
+      }
+      filled += n;
+    }
+  }
+
+  // Reserve, so the chunk header buffers stay valid
+  _requestChunkBuffer.reserve(chunksPerWrite * maxChunkHeaderSize);
+  uint8_t const* data = _requestBody.data() + _requestBodyOffset;
+  for (std::size_t offset = 0; offset < length; offset += maxDataLength) {
+    ChunkHeader chunk;
+    chunk._chunkX = _requestNextChunk++ << 1;
+    chunk._messageID = _messageID;
+    chunk._messageLength = _requestMessageLength;
+    chunk._data = boost::asio::const_buffer(data + offset, std::min(maxDataLength, length - offset));
+    auto chunkOffset = _requestChunkBuffer.byteSize();
+    size_t chunkHdrLen = ChunkCodec<V>::writeHeader(chunk, _requestChunkBuffer);
+    _requestBuffers.push_back(boost::asio::const_buffer(_requestChunkBuffer.data()+chunkOffset, chunkHdrLen));
+    _requestBuffers.push_back(chunk._data);
+  }
+  _requestBodyOffset += length;
+  _requestBodyRemaining -= length;
+  return true;
+}
+
+bool RequestItem::nextBodyChunks(VSTVersion vstVersion) {
+  switch (vstVersion) {
+    case VST1_0:
+      return nextBodyChunks<VST1_0>();
+    case VST1_1:
+      return nextBodyChunks<VST1_1>();
+    default:
+      throw std::logic_error("Unknown VST version");
+  }
+}
+
+// prepareBody sets up sending a streamed body after the given chunks of the
+// message header.
+void RequestItem::prepareBody(std::vector<ChunkHeader>& chunks) {
+  _bodySource = _request->bodySource();
+  auto size = _bodySource->size();
+  if (!size) {
+    // VST announces the length of the message up front, so a body of
+    // unknown size has to be read before it can be sent.
+    static std::size_t const readSize = 64 * 1024;
+    std::size_t length = 0;
+    do {
+      _requestBody.resize(length + readSize);
+      auto n = _bodySource->read(_requestBody.data() + length, readSize);
+      length += n;
+      if (n == 0) {
+        break;
+      }
+    } while (true);
+    _requestBody.resize(length);
+    _bodySource.reset();
+    size = length;
+  }
+
+  std::size_t const maxDataLength = defaultMaxChunkSize - maxChunkHeaderSize;
+  uint64_t numberOfChunks = chunks.size() + (size.get() + maxDataLength - 1) / maxDataLength;
+  _requestBodyOffset = 0;
+  _requestBodyRemaining = size.get();
+  _requestMessageLength = _msgHdr.size() + size.get();
+  _requestNextChunk = static_cast<uint32_t>(chunks.size());
+  for (auto& chunk : chunks) {
+    chunk._messageLength = _requestMessageLength;
+  }
+  if (numberOfChunks > 1) {
+    chunks[0]._chunkX = static_cast<uint32_t>((numberOfChunks << 1) + 1);
+  }
+}
+
+void RequestItem::prepareForNetwork(VSTVersion vstVersion) {
+  switch (vstVersion) {
+    case VST1_0:
+      prepareForNetwork<VST1_0>();
+      break;
+    case VST1_1:
+      prepareForNetwork<VST1_1>();
+      break;
+    default:
+      throw std::logic_error("Unknown VST version");
+  }
+}
+
 ///////////////////////////////////////////////////////////////////////////////////
 // receiving vst
 ///////////////////////////////////////////////////////////////////////////////////
@@ -290,43 +396,20 @@ std::size_t isChunkComplete(uint8_t const * const begin, std::size_t const lengt
 // readChunkHeaderVST1_0 reads a chunk header in VST1.0 format.
 ChunkHeader readChunkHeaderVST1_0(uint8_t const * const bufferBegin) {
   ChunkHeader header;
-
-  auto hdr = bufferBegin;
-  header._chunkLength = le32toh(*reinterpret_cast<const uint32_t*>(hdr+0));
-  header._chunkX = le32toh(*reinterpret_cast<const uint32_t*>(hdr+4));
-  header._messageID = le64toh(*reinterpret_cast<const uint64_t*>(hdr+8));
-  size_t hdrLen = minChunkHeaderSize;
-
-	if ((1 == (header._chunkX & 0x1)) && ((header._chunkX >> 1) > 1)) {
-		// First chunk, numberOfChunks>1 -> read messageLength
-		header._messageLength = le64toh(*reinterpret_cast<const uint64_t*>(hdr+16));
-    hdrLen = maxChunkHeaderSize;
-	}
-
-  size_t contentLength = header._chunkLength - hdrLen;
-  header._data = boost::asio::const_buffer(hdr+hdrLen, contentLength);
-  FUERTE_LOG_VSTCHUNKTRACE << "readChunkHeaderVST1_0: got " << contentLength << " data bytes after " << hdrLen << " header bytes" << std::endl;
-
+  ChunkCodec<VST1_0>::readHeader(bufferBegin, header);
+  FUERTE_LOG_VSTCHUNKTRACE << "readChunkHeaderVST1_0: got " << boost::asio::buffer_size(header._data) << " data bytes" << std::endl;
   return header;
 }
 
 // readChunkHeaderVST1_1 reads a chunk header in VST1.1 format.
 ChunkHeader readChunkHeaderVST1_1(uint8_t const * const bufferBegin) {
   ChunkHeader header;
-
-  auto hdr = bufferBegin;
-  header._chunkLength = le32toh(*reinterpret_cast<const uint32_t*>(hdr+0));
-  header._chunkX = le32toh(*reinterpret_cast<const uint32_t*>(hdr+4));
-  header._messageID = le64toh(*reinterpret_cast<const uint64_t*>(hdr+8));
-  header._messageLength = le64toh(*reinterpret_cast<const uint64_t*>(hdr+16));
-  size_t contentLength = header._chunkLength - maxChunkHeaderSize;
-  header._data = boost::asio::const_buffer(hdr+maxChunkHeaderSize, contentLength);
-  FUERTE_LOG_VSTCHUNKTRACE << "readChunkHeaderVST1_1: got " << contentLength << " data bytes after " << std::endl;
-
+  ChunkCodec<VST1_1>::readHeader(bufferBegin, header);
+  FUERTE_LOG_VSTCHUNKTRACE << "readChunkHeaderVST1_1: got " << boost::asio::buffer_size(header._data) << " data bytes" << std::endl;
   return header;
 }
 
-MessageHeader messageHeaderFromSlice(int vstVersionID, VSlice const& headerSlice){
+MessageHeader messageHeaderFromSlice(int vstVersionID, VSlice const& headerSlice, bool decodeResponseMeta){
   assert(headerSlice.isArray());
   MessageHeader header;
   header.byteSize = headerSlice.byteSize(); //for debugging
@@ -352,15 +435,15 @@ MessageHeader messageHeaderFromSlice(int vstVersionID, VSlice const& headerSlice
       header.restVerb = static_cast<RestVerb>(headerSlice.at(3).getInt());          // rest verb
       header.path = headerSlice.at(4).copyString();                                 // request (path)
       header.parameters = sliceToStringMap(headerSlice.at(5));                      // query params
-      header.meta = sliceToStringMap(headerSlice.at(6));                            // meta
+      header.meta = sliceToHeaderMap(headerSlice.at(6));                            // meta
       break;
 
     //resoponse should get content type
     case MessageType::Response:
       header.responseCode = headerSlice.at(2).getUInt(); // TODO fix me
       header.contentType(ContentType::VPack);
-      if (headerSlice.length() >= 4) {
-        header.meta = sliceToStringMap(headerSlice.at(3));                          // meta
+      if (decodeResponseMeta && headerSlice.length() >= 4) {
+        header.meta = sliceToHeaderMap(headerSlice.at(3));                          // meta
       }
       break;
     default:
@@ -370,13 +453,12 @@ MessageHeader messageHeaderFromSlice(int vstVersionID, VSlice const& headerSlice
   return header;
 };
 
-MessageHeader validateAndExtractMessageHeader(int const& vstVersionID, uint8_t const * const vpStart, std::size_t length, std::size_t& headerLength){
+std::size_t validateMessageHeader(uint8_t const * const vpStart, std::size_t length){
   using VValidator = ::arangodb::velocypack::Validator;
   // there must be at least one velocypack for the header
   VValidator validator;
   bool isSubPart = true;
 
-  VSlice slice;
   try {
     // isSubPart allows the slice to be shorter than the checked buffer.
     validator.validate(vpStart, length , isSubPart);
@@ -385,10 +467,66 @@ MessageHeader validateAndExtractMessageHeader(int const& vstVersionID, uint8_t c
     FUERTE_LOG_VSTTRACE << "len: " << length << std::string(reinterpret_cast<char const*>(vpStart), length);
     throw std::runtime_error(std::string("error during validation of incoming VPack (HEADER): ") + e.what());
   }
-  slice = VSlice(vpStart);
-  headerLength = slice.byteSize();
+  return VSlice(vpStart).byteSize();
+}
+
+// fits returns true when the velocypack value at start fits into the given
+// length. Only the bytes needed to determine its size are read.
+static bool fits(uint8_t const * const start, std::size_t length) {
+  if (length == 0) {
+    return false;
+  }
+  uint8_t head = *start;
+  std::size_t needed = 1;
+  if ((head >= 0x02 && head <= 0x09) || (head >= 0x0b && head <= 0x12)) {
+    // array / object with a byte length of 1, 2, 4 or 8 bytes
+    needed += std::size_t(1) << ((head - (head <= 0x09 ? 0x02 : 0x0b)) & 3);
+  } else if (head == 0x13 || head == 0x14) {
+    // compact array / object with a variable length byte length
+    while (needed < length && needed <= 8 && (start[needed] & 0x80)) {
+      needed++;
+    }
+    needed++;
+  } else if (head >= 0xbf) {
+    // long strings, binary data and custom types are never part of a header
+    return false;
+  }
+  return needed <= length && VSlice(start).byteSize() <= length;
+}
+
+std::size_t checkResponseHeader(uint8_t const * const vpStart, std::size_t length){
+  // the header is small, the Validator makes sure every part of it lies
+  // within the range before its fields are read
+  std::size_t headerLength = validateMessageHeader(vpStart, length);
+  VSlice header(vpStart);
+  if (!header.isArray()) {
+    throw std::runtime_error("invalid VST message header");
+  }
 
-  return messageHeaderFromSlice(vstVersionID, slice);
+  auto members = header.length();
+  if (members < 3 || members > 4) {
+    throw std::runtime_error("invalid VST message header: unexpected number of fields");
+  }
+  for (std::size_t i = 0; i < members; i++) {
+    // version, type & response code are integers, followed by the meta object
+    VSlice member = header.at(i);
+    if (!(i < 3 ? member.isInteger() : member.isObject())) {
+      throw std::runtime_error("invalid VST message header: field " + std::to_string(i));
+    }
+  }
+  return headerLength;
+}
+
+std::size_t messageHeaderSize(uint8_t const * const vpStart, std::size_t length){
+  if (!fits(vpStart, length)) {
+    throw std::runtime_error("invalid VST message header");
+  }
+  return VSlice(vpStart).byteSize();
+}
+
+MessageHeader validateAndExtractMessageHeader(int const& vstVersionID, uint8_t const * const vpStart, std::size_t length, std::size_t& headerLength){
+  headerLength = validateMessageHeader(vpStart, length);
+  return messageHeaderFromSlice(vstVersionID, VSlice(vpStart));
 }
 
 std::size_t validateAndCount(uint8_t const * const vpStart, std::size_t length){
@@ -433,7 +571,7 @@ void RequestItem::addChunk(ChunkHeader& chunk) {
   auto contentStart = boost::asio::buffer_cast<const uint8_t*>(chunk._data);
   chunk._responseContentLength = boost::asio::buffer_size(chunk._data);
   FUERTE_LOG_VSTCHUNKTRACE << "RequestItem::addChunk: adding " << chunk._responseContentLength << " bytes to buffer" << std::endl;
-  chunk._responseChunkContentOffset = _responseChunkContent.byteSize();
+  chunk._responseChunkContentOffset = _responseChunkContent.size();
   _responseChunkContent.append(contentStart, chunk._responseContentLength);
   // Release _data in chunk 
   chunk._data = boost::asio::const_buffer();
@@ -450,7 +588,7 @@ static bool chunkByIndex (const ChunkHeader& a, const ChunkHeader& b) { return (
 
 // try to assembly the received chunks into a buffer.
 // returns NULL if not all chunks are available.
-std::unique_ptr<VBuffer> RequestItem::assemble() {
+std::unique_ptr<SpillBuffer> RequestItem::assemble() {
   if (_responseNumberOfChunks == 0) {
 		// We don't have the first chunk yet
     FUERTE_LOG_VSTCHUNKTRACE << "RequestItem::assemble: don't have first chunk" << std::endl;
@@ -468,12 +606,94 @@ std::unique_ptr<VBuffer> RequestItem::assemble() {
 
   // Combine chunk content 
   FUERTE_LOG_VSTCHUNKTRACE << "RequestItem::assemble: build response buffer" << std::endl;
-  auto buffer = std::unique_ptr<VBuffer>(new VBuffer());
+  bool inOrder = true;
+  size_t offset = 0;
   for (auto it = std::begin(_responseChunks); it!=std::end(_responseChunks); ++it) {
-    buffer->append(_responseChunkContent.data() + it->_responseChunkContentOffset, it->_responseContentLength);
+    if (it->_responseChunkContentOffset != offset) {
+      inOrder = false;
+      break;
+    }
+    offset += it->_responseContentLength;
+  }
+  if (!inOrder) {
+    // copy the content in index order (the buffer keeps its configuration)
+    SpillBuffer received;
+    received.swap(_responseChunkContent);
+    auto content = received.data();
+    for (auto it = std::begin(_responseChunks); it!=std::end(_responseChunks); ++it) {
+      _responseChunkContent.append(content + it->_responseChunkContentOffset, it->_responseContentLength);
+    }
   }
+  // chunks that arrived in order are used as they are
+  auto buffer = std::unique_ptr<SpillBuffer>(new SpillBuffer());
+  buffer->swap(_responseChunkContent);
 
   return buffer;
 }
 
+// pass the content of the given chunk to the data callback of the request.
+// returns true when the last chunk has been passed on.
+bool RequestItem::streamChunk(ChunkHeader& chunk) {
+  if (chunk.isFirst()) {
+    _responseNumberOfChunks = chunk.numberOfChunks();
+  }
+  if (chunk.index() != _streamNextIndex) {
+    // keep it until all chunks in front of it have been passed on
+    FUERTE_LOG_VSTCHUNKTRACE << "RequestItem::streamChunk: keeping chunk " << chunk.index() << std::endl;
+    chunk._responseContentLength = boost::asio::buffer_size(chunk._data);
+    chunk._responseChunkContentOffset = _streamChunkContent.size();
+    _streamChunkContent.append(boost::asio::buffer_cast<uint8_t const*>(chunk._data), chunk._responseContentLength);
+    chunk._data = boost::asio::const_buffer();
+    _responseChunks.push_back(chunk);
+    return false;
+  }
+
+  auto const& dataCallback = _request->responseDataCallback();
+  auto pass = [&](uint8_t const* data, std::size_t length) {
+    if (_streamHeaderLength == 0) {
+      // the message header comes first, collect it before passing on anything
+      _streamHeader.append(data, length);
+      if (!fits(_streamHeader.data(), _streamHeader.byteSize())) {
+        return;
+      }
+      _streamHeaderLength = checkResponseHeader(_streamHeader.data(), _streamHeader.byteSize());
+      _streamStatusCode = static_cast<StatusCode>(VSlice(_streamHeader.data()).at(2).getUInt());
+      std::size_t rest = _streamHeader.byteSize() - _streamHeaderLength;
+      if (rest > 0) {
+        dataCallback(_streamStatusCode, _streamHeader.data() + _streamHeaderLength, rest);
+      }
+      _streamHeader.resetTo(_streamHeaderLength);
+    } else if (length > 0) {
+      dataCallback(_streamStatusCode, data, length);
+    }
+  };
+
+  pass(boost::asio::buffer_cast<uint8_t const*>(chunk._data), boost::asio::buffer_size(chunk._data));
+  _streamNextIndex++;
+
+  // pass on the chunks that were waiting for this one
+  auto it = _responseChunks.begin();
+  while (it != _responseChunks.end()) {
+    if (it->index() != _streamNextIndex) {
+      ++it;
+      continue;
+    }
+    pass(_streamChunkContent.data() + it->_responseChunkContentOffset, it->_responseContentLength);
+    _streamNextIndex++;
+    _responseChunks.erase(it);
+    it = _responseChunks.begin();
+  }
+  if (_responseChunks.empty()) {
+    _streamChunkContent.clear();
+  }
+
+  if (_responseNumberOfChunks == 0 || _streamNextIndex < _responseNumberOfChunks) {
+    return false;
+  }
+  if (_streamHeaderLength == 0) {
+    throw std::runtime_error("invalid VST message header");
+  }
+  return true;
+}
+
 }}}}
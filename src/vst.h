@@ -36,6 +36,8 @@
 #include <fuerte/FuerteLogger.h>
 
 #include "CallOnceRequestCallback.h"
+#include "SpillBuffer.h"
+#include "portable_endian.h"
 
 namespace arangodb { namespace fuerte { inline namespace v1 { namespace vst {
 
@@ -105,16 +107,125 @@ struct ChunkHeader {
 // The resulting set of chunks are added to the given result vector.
 void buildChunks(uint64_t messageID, uint32_t maxChunkSize, std::vector<VSlice> const& messageParts, std::vector<ChunkHeader>& result);
 
+/////////////////////////////////////////////////////////////////////////////////////
+// ChunkCodec
+/////////////////////////////////////////////////////////////////////////////////////
+
+// ChunkCodec contains the parts of VST that differ between protocol versions.
+// Code that handles chunks is instantiated per version, so it does not have
+// to check the version for every chunk.
+template <VSTVersion V> struct ChunkCodec;
+
+template <> struct ChunkCodec<VST1_0> {
+  // protocol header that is send when the connection is opened
+  static inline char const* protocolHeader() { return vstHeader1_0; }
+
+  // headerLength returns the length of a chunk header.
+  static inline std::size_t headerLength(bool isFirst, bool isSingle) {
+    return (isFirst && !isSingle) ? maxChunkHeaderSize : minChunkHeaderSize;
+  }
+
+  // headerLength returns the length of the chunk header at hdr, which must
+  // have at least minChunkHeaderSize bytes.
+  static inline std::size_t headerLength(uint8_t const* hdr) {
+    uint32_t chunkX = le32toh(*reinterpret_cast<const uint32_t*>(hdr+4));
+    return headerLength(1 == (chunkX & 0x1), (chunkX >> 1) <= 1);
+  }
+
+  // writeHeader appends the header of the given chunk to the given buffer
+  // and returns its length.
+  static inline std::size_t writeHeader(ChunkHeader const& chunk, VBuffer& buffer) {
+    return chunk.writeHeaderToVST1_0(buffer);
+  }
+
+  // readHeader reads the chunk header at hdr into the given header.
+  static inline void readHeader(uint8_t const* hdr, ChunkHeader& header) {
+    header._chunkLength = le32toh(*reinterpret_cast<const uint32_t*>(hdr+0));
+    header._chunkX = le32toh(*reinterpret_cast<const uint32_t*>(hdr+4));
+    header._messageID = le64toh(*reinterpret_cast<const uint64_t*>(hdr+8));
+    std::size_t hdrLen = minChunkHeaderSize;
+    if ((1 == (header._chunkX & 0x1)) && ((header._chunkX >> 1) > 1)) {
+      // First chunk, numberOfChunks>1 -> read messageLength
+      header._messageLength = le64toh(*reinterpret_cast<const uint64_t*>(hdr+16));
+      hdrLen = maxChunkHeaderSize;
+    } else {
+      header._messageLength = 0;
+    }
+    header._data = boost::asio::const_buffer(hdr+hdrLen, header._chunkLength - hdrLen);
+  }
+};
+
+template <> struct ChunkCodec<VST1_1> {
+  // protocol header that is send when the connection is opened
+  static inline char const* protocolHeader() { return vstHeader1_1; }
+
+  // headerLength returns the length of a chunk header.
+  static inline std::size_t headerLength(bool, bool) { return maxChunkHeaderSize; }
+  static inline std::size_t headerLength(uint8_t const*) { return maxChunkHeaderSize; }
+
+  // writeHeader appends the header of the given chunk to the given buffer
+  // and returns its length.
+  static inline std::size_t writeHeader(ChunkHeader const& chunk, VBuffer& buffer) {
+    return chunk.writeHeaderToVST1_1(buffer);
+  }
+
+  // readHeader reads the chunk header at hdr into the given header.
+  static inline void readHeader(uint8_t const* hdr, ChunkHeader& header) {
+    header._chunkLength = le32toh(*reinterpret_cast<const uint32_t*>(hdr+0));
+    header._chunkX = le32toh(*reinterpret_cast<const uint32_t*>(hdr+4));
+    header._messageID = le64toh(*reinterpret_cast<const uint64_t*>(hdr+8));
+    header._messageLength = le64toh(*reinterpret_cast<const uint64_t*>(hdr+16));
+    header._data = boost::asio::const_buffer(hdr+maxChunkHeaderSize, header._chunkLength - maxChunkHeaderSize);
+  }
+};
+
+// readChunks reads the headers of all complete chunks at the start of the
+// given data in one pass and appends them to result.
+// The number of bytes occupied by these chunks is returned.
+// Throws std::runtime_error when a chunk is shorter than its own header.
+template <VSTVersion V>
+std::size_t readChunks(uint8_t const* data, std::size_t available, std::vector<ChunkHeader>& result) {
+  std::size_t const minLength = ChunkCodec<V>::headerLength(false, true);
+  uint8_t const* cursor = data;
+  while (available >= minLength) {
+    uint32_t chunkLength = le32toh(*reinterpret_cast<const uint32_t*>(cursor));
+    if (chunkLength > available) {
+      // incomplete chunk
+      break;
+    }
+    if (chunkLength < ChunkCodec<V>::headerLength(cursor)) {
+      throw std::runtime_error("invalid VST chunk length " + std::to_string(chunkLength));
+    }
+    result.emplace_back();
+    ChunkCodec<V>::readHeader(cursor, result.back());
+    cursor += chunkLength;
+    available -= chunkLength;
+  }
+  return cursor - data;
+}
+
+// ReadChunksFunction is the type of readChunks<V>.
+typedef std::size_t (*ReadChunksFunction)(uint8_t const*, std::size_t, std::vector<ChunkHeader>&);
+
+// readChunksFunction returns readChunks for the given version.
+inline ReadChunksFunction readChunksFunction(VSTVersion vstVersion) {
+  switch (vstVersion) {
+    case VST1_0:
+      return &readChunks<VST1_0>;
+    case VST1_1:
+      return &readChunks<VST1_1>;
+    default:
+      throw std::logic_error("Unknown VST version");
+  }
+}
+
 // chunkHeaderLength returns the length of a VST chunk header for given arguments.
 inline std::size_t chunkHeaderLength(VSTVersion vstVersion, bool isFirst, bool isSingle) {
   switch (vstVersion) {
     case VST1_0:
-      if (isFirst && !isSingle) {
-        return maxChunkHeaderSize;
-      }
-      return minChunkHeaderSize;
+      return ChunkCodec<VST1_0>::headerLength(isFirst, isSingle);
     case VST1_1:
-      return maxChunkHeaderSize;
+      return ChunkCodec<VST1_1>::headerLength(isFirst, isSingle);
     default:
       throw std::logic_error("Unknown VST version");
   }
@@ -129,10 +240,24 @@ struct RequestItem {
   std::string _msgHdr;                // VST message header
   VBuffer _requestChunkBuffer;        // Buffer used to hold chunk headers
   std::vector<boost::asio::const_buffer> _requestBuffers; // Buffers the will be send to the socket.
+  // Streamed request body (see Request::bodySource)
+  std::shared_ptr<RequestBodySource> _bodySource; // Source of the body (nullptr when it is buffered).
+  std::vector<uint8_t> _requestBody;  // Buffered body or the part of the body that is being sent.
+  size_t _requestBodyOffset;          // Offset of the data to send next in _requestBody.
+  uint64_t _requestBodyRemaining;     // Number of body bytes that still have to be sent.
+  uint64_t _requestMessageLength;     // Length of the entire message.
+  uint32_t _requestNextChunk;         // Index of the next chunk to send.
   // Response variables
   std::vector<ChunkHeader> _responseChunks; // List of chunks that have been received.
-  VBuffer _responseChunkContent;      // Buffer containing content of received chunks. (this is not in sorted order!)
+  SpillBuffer _responseChunkContent;  // Buffer containing content of received chunks. (this is not in sorted order!)
   size_t _responseNumberOfChunks;     // The number of chunks we're expecting (0==not know yet).
+  // Streamed response variables (see Request::streamResponse)
+  VBuffer _streamHeader;              // Message header of a streamed response.
+  VBuffer _streamChunkContent;        // Content of chunks that arrived early (never spilled,
+                                      // more chunks are appended while it is read).
+  size_t _streamHeaderLength;         // Length of the message header (0==not complete yet).
+  uint32_t _streamNextIndex;          // Index of the next chunk to pass on.
+  StatusCode _streamStatusCode;       // Response code of a streamed response.
 
   inline MessageID messageID() { return _messageID; }
   inline void invokeOnError(Error e, std::unique_ptr<Request> req, std::unique_ptr<Response> res) { 
@@ -142,12 +267,30 @@ struct RequestItem {
   // prepareForNetwork prepares the internal structures for writing the request 
   // to the network.
   void prepareForNetwork(VSTVersion);
+  template <VSTVersion V>
+  void prepareForNetwork();
+
+  // prepareBody sets up sending a streamed body after the given chunks of the
+  // message header.
+  void prepareBody(std::vector<ChunkHeader>& chunks);
+
+  // nextBodyChunks prepares the next chunks of a streamed body for writing.
+  // returns false when the entire body has been written.
+  bool nextBodyChunks(VSTVersion);
+  template <VSTVersion V>
+  bool nextBodyChunks();
 
   // add the given chunk to the list of response chunks.
   void addChunk(ChunkHeader&);
   // try to assembly the received chunks into a response.
   // returns NULL if not all chunks are available.
-  std::unique_ptr<VBuffer> assemble();
+  std::unique_ptr<SpillBuffer> assemble();
+
+  // pass the content of the given chunk to the data callback of the request.
+  // Chunks are passed on in index order, chunks that arrive early are kept
+  // until it is their turn. The message header is collected in _streamHeader.
+  // returns true when the last chunk has been passed on.
+  bool streamChunk(ChunkHeader&);
 
   // Flush all memory needed for sending this request.
   inline void resetSendData() {
@@ -172,11 +315,22 @@ ChunkHeader readChunkHeaderVST1_0(uint8_t const * const bufferBegin);
 // readChunkHeaderVST1_1 reads a chunk header in VST1.1 format.
 ChunkHeader readChunkHeaderVST1_1(uint8_t const * const bufferBegin);
 
-// creates a MessageHeader form a given slice
-MessageHeader messageHeaderFromSlice(VSlice const& headerSlice);
+// creates a MessageHeader form a given slice.
+// The meta data of responses is left alone when decodeResponseMeta is false.
+MessageHeader messageHeaderFromSlice(int vstVersionID, VSlice const& headerSlice, bool decodeResponseMeta = true);
+// validates if a data range starts with a slice and returns the size
+// occupied by that slice
+std::size_t validateMessageHeader(uint8_t const * const vpStart, std::size_t length);
+// validates that a data range starts with a response header
+// ([version, type, responseCode(, meta)]) and returns the size occupied by
+// the header. The payload is not looked at.
+std::size_t checkResponseHeader(uint8_t const * const vpStart, std::size_t length);
+// returns the size occupied by the slice at the start of a data range
+// after checking that it fits into the range, nothing else is checked.
+std::size_t messageHeaderSize(uint8_t const * const vpStart, std::size_t length);
 // validates if a data range contains a slice and converts it
 // to a message Hader and returns size occupied by the sloce via reference
-MessageHeader validateAndExtractMessageHeader(int const& vstVersionID, uint8_t const * const vpStart, std::size_t length, std::size_t& headerLength);\
+MessageHeader validateAndExtractMessageHeader(int const& vstVersionID, uint8_t const * const vpStart, std::size_t length, std::size_t& headerLength);
 
 //Validates if payload consitsts of valid velocypack slices
 std::size_t validateAndCount(uint8_t const* vpHeaderStart, std::size_t len);
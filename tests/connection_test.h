@@ -38,10 +38,15 @@ typedef struct {
   const char *_url;       // Server URL
   const size_t _threads;  // #Threads to use for the EventLoopService 
   const size_t _repeat;   // Number of times to repeat repeatable tests.
+  const f::http::HTTPBackend _httpBackend; // Implementation used for HTTP connections
+  const bool _httpPipelining;              // Pipeline HTTP requests (AsioBackend only)
+  const f::vst::ValidationLevel _vstValidation; // Validation of received messages (VST only)
 } ConnectionTestParams;
 
 ::std::ostream& operator<<(::std::ostream& os, const ConnectionTestParams& p) {
-  return os << "url=" << p._url << " threads=" << p._threads;
+  return os << "url=" << p._url << " threads=" << p._threads
+            << " httpBackend=" << p._httpBackend << " httpPipelining=" << p._httpPipelining
+            << " vstValidation=" << p._vstValidation;
 }
 
 // ConnectionTestF is a test fixture that can be used for all kinds of connection 
@@ -59,12 +64,14 @@ class ConnectionTestF : public ::testing::TestWithParam<ConnectionTestParams> {
   virtual void SetUp() override {
     try {
       // Set connection parameters
-      f::ConnectionBuilder cbuilder;
-      cbuilder.host(GetParam()._url);
-      setupAuthenticationFromEnv(cbuilder);
+      _builder.host(GetParam()._url);
+      _builder.httpBackend(GetParam()._httpBackend);
+      _builder.httpPipelining(GetParam()._httpPipelining);
+      _builder.vstValidation(GetParam()._vstValidation);
+      setupAuthenticationFromEnv(_builder);
 
       // make connection
-      _connection = cbuilder.connect(*_eventLoopService);
+      _connection = _builder.connect(*_eventLoopService);
     } catch(std::exception const& ex) {
       std::cout << "SETUP OF FIXTURE FAILED" << std::endl;
       throw ex;
@@ -80,6 +87,12 @@ class ConnectionTestF : public ::testing::TestWithParam<ConnectionTestParams> {
     return std::max(GetParam()._repeat, size_t(1));
   }
 
+  // Make another connection with the given parameters.
+  std::shared_ptr<f::Connection> connect(f::ConnectionBuilder& builder) {
+    return builder.connect(*_eventLoopService);
+  }
+
+  f::ConnectionBuilder _builder;
   std::shared_ptr<f::Connection> _connection;
 
  private:
@@ -21,6 +21,12 @@
 /// @author Ewout Prangsma
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+
 #include <fuerte/fuerte.h>
 #include <fuerte/loop.h>
 #include <fuerte/helper.h>
@@ -66,6 +72,93 @@ TEST_P(ConnectionTestF, ApiVersionASync) {
   }
 }
 
+TEST_P(ConnectionTestF, ApiVersionSingleFlight) {
+  // concurrent identical requests share one response
+  auto connection = connect(_builder.singleFlight(true));
+  f::WaitGroup wg;
+  std::atomic<int> ok(0);
+  std::set<fu::MessageID> ids;
+  for (int i = 0; i < 10; i++) {
+    wg.add();
+    // a request that attaches to the one in flight returns its message id
+    ids.insert(connection->sendRequest(fu::createRequest(fu::RestVerb::Get, "/_api/version"),
+        [&](fu::Error error, std::unique_ptr<fu::Request>, std::unique_ptr<fu::Response> res) {
+      f::WaitGroupDone done(wg);
+      if (error == 0 && res->statusCode() == f::StatusOK &&
+          res->slices().front().get("server").copyString() == "arango") {
+        ok++;
+      }
+    }));
+  }
+  ASSERT_TRUE(wg.wait_for(std::chrono::seconds(10)));
+  ASSERT_EQ(ok.load(), 10);
+  // the requests were sent far faster than a round trip, so some shared one
+  ASSERT_LT(ids.size(), 10u);
+}
+
+TEST_P(ConnectionTestF, ApiVersionCached) {
+  // repeated requests are answered from the cache, then revalidated
+  auto connection = connect(_builder.responseCacheSize(16)
+                                    .responseCacheTTL(std::chrono::milliseconds(100)));
+  for (auto rep = 0; rep < 3; rep++) {
+    auto result = connection->sendRequest(fu::createRequest(fu::RestVerb::Get, "/_api/version"));
+    ASSERT_EQ(result->statusCode(), f::StatusOK);
+    ASSERT_EQ(result->slices().front().get("server").copyString(), "arango");
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  auto result = connection->sendRequest(fu::createRequest(fu::RestVerb::Get, "/_api/version"));
+  ASSERT_EQ(result->statusCode(), f::StatusOK);
+  ASSERT_EQ(result->slices().front().get("server").copyString(), "arango");
+}
+
+TEST_P(ConnectionTestF, DocumentRevalidated) {
+  // a stale document is revalidated, the server answers 304 and the cached
+  // document is served
+  auto connection = connect(_builder.responseCacheSize(16)
+                                    .responseCacheTTL(std::chrono::milliseconds(100)));
+  auto create = fu::createRequest(fu::RestVerb::Post, "/_api/document/_users");
+  create->addVPack(fu::VSlice::emptyObjectSlice());
+  auto created = connection->sendRequest(std::move(create));
+  ASSERT_EQ(created->statusCode(), f::StatusAccepted);
+  auto path = "/_api/document/" + created->slices().front().get("_id").copyString();
+
+  auto first = connection->sendRequest(fu::createRequest(fu::RestVerb::Get, path));
+  ASSERT_EQ(first->statusCode(), f::StatusOK);
+  auto etag = first->header.metaByKey("etag");
+  ASSERT_FALSE(etag.empty());
+
+  // the server answers a request with the ETag of the cached document with 304
+  auto check = fu::createRequest(fu::RestVerb::Get, path);
+  check->header.addMeta("if-none-match", etag);
+  ASSERT_EQ(_connection->sendRequest(std::move(check))->statusCode(), f::StatusNotModified);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  auto request = fu::createRequest(fu::RestVerb::Get, path);
+  auto result = connection->sendRequest(std::move(request));
+  ASSERT_EQ(result->statusCode(), f::StatusOK);
+  ASSERT_EQ(result->header.metaByKey("etag"), etag);
+  ASSERT_EQ(result->slices().front().get("_rev").copyString(),
+            first->slices().front().get("_rev").copyString());
+
+  // the caller's request is not changed
+  auto plain = fu::createRequest(fu::RestVerb::Get, path);
+  fu::WaitGroup wg;
+  wg.add();
+  std::string sentEtag = "unset";
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  connection->sendRequest(std::move(plain),
+      [&](fu::Error error, std::unique_ptr<fu::Request> req, std::unique_ptr<fu::Response> res) {
+    f::WaitGroupDone done(wg);
+    if (error == 0 && req && res && res->statusCode() == f::StatusOK) {
+      sentEtag = req->header.metaByKey("if-none-match");
+    }
+  });
+  ASSERT_TRUE(wg.wait_for(std::chrono::seconds(10)));
+  ASSERT_EQ(sentEtag, "");
+
+  connection->sendRequest(fu::createRequest(fu::RestVerb::Delete, path));
+}
+
 TEST_P(ConnectionTestF, ApiVersionSync20) {
   for (auto rep = 0; rep < repeat(); rep++) {
     auto request = fu::createRequest(fu::RestVerb::Get, "/_api/version");
@@ -108,6 +201,27 @@ TEST_P(ConnectionTestF, ApiVersionASync20) {
   }
 }
 
+TEST_P(ConnectionTestF, ApiVersionStreamed) {
+  for (auto rep = 0; rep < repeat(); rep++) {
+    auto request = fu::createRequest(fu::RestVerb::Get, "/_api/version");
+    auto expected = _connection->sendRequest(*request);
+    ASSERT_EQ(expected->statusCode(), f::StatusOK);
+
+    f::VBuffer streamed;
+    fu::StatusCode streamedStatus = 0;
+    request->streamResponse([&](fu::StatusCode status, uint8_t const* data, std::size_t length) {
+      streamedStatus = status;
+      streamed.append(data, length);
+    });
+    auto result = _connection->sendRequest(std::move(request));
+    ASSERT_EQ(result->statusCode(), f::StatusOK);
+    ASSERT_EQ(streamedStatus, f::StatusOK);
+    ASSERT_EQ(boost::asio::buffer_size(result->payload()), 0);
+    auto version = fu::VSlice(streamed.data()).get("version").copyString();
+    ASSERT_EQ(version[0], _major_arango_version);
+  }
+}
+
 TEST_P(ConnectionTestF, SimpleCursorSync){
   auto request = fu::createRequest(fu::RestVerb::Post, "/_api/cursor");
   fu::VBuilder builder;
@@ -125,6 +239,144 @@ TEST_P(ConnectionTestF, SimpleCursorSync){
   ASSERT_TRUE(result.length() == 5);
 }
 
+TEST_P(ConnectionTestF, SimpleCursorBodySource){
+  fu::VBuilder builder;
+  builder.openObject();
+  builder.add("query", fu::VValue("FOR x IN 1..5 RETURN x"));
+  builder.close();
+  auto body = builder.slice();
+
+  for (int knownSize = 0; knownSize < 2; knownSize++) {
+    auto request = fu::createRequest(fu::RestVerb::Post, "/_api/cursor");
+    request->contentType(fu::ContentType::VPack);
+    std::size_t offset = 0;
+    auto reader = [&](uint8_t* buffer, std::size_t length) {
+      // hand out the body in small parts
+      std::size_t n = std::min<std::size_t>(std::min<std::size_t>(length, 7), body.byteSize() - offset);
+      std::memcpy(buffer, body.start() + offset, n);
+      offset += n;
+      return n;
+    };
+    auto size = knownSize ? boost::optional<std::size_t>(body.byteSize()) : boost::none;
+    request->addBodySource(fu::bodySourceFromReader(reader, size));
+    auto response = _connection->sendRequest(std::move(request));
+    ASSERT_EQ(response->statusCode(), f::StatusCreated);
+    auto slice = response->slices().front();
+
+    ASSERT_TRUE(slice.isObject());
+    auto result = slice.get("result");
+    ASSERT_TRUE(result.isArray());
+    ASSERT_TRUE(result.length() == 5);
+  }
+}
+
+TEST_P(ConnectionTestF, SimpleCursorMappedFile){
+  fu::VBuilder builder;
+  builder.openObject();
+  builder.add("query", fu::VValue("FOR x IN 1..5 RETURN x"));
+  builder.close();
+  std::string path = "fuerte_test_cursor.vpack";
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<char const*>(builder.slice().start()), builder.slice().byteSize());
+  }
+
+  auto request = fu::createRequest(fu::RestVerb::Post, "/_api/cursor");
+  request->addVPack(std::make_shared<fu::MappedFile>(path));
+  std::remove(path.c_str());
+  auto response = _connection->sendRequest(std::move(request));
+  ASSERT_EQ(response->statusCode(), f::StatusCreated);
+  auto slice = response->slices().front();
+
+  ASSERT_TRUE(slice.isObject());
+  auto result = slice.get("result");
+  ASSERT_TRUE(result.isArray());
+  ASSERT_TRUE(result.length() == 5);
+}
+
+TEST_P(ConnectionTestF, SimpleCursorSpilled){
+  // responses larger than 64 bytes are kept in a temporary file
+  auto connection = connect(_builder.responseSpillThreshold(64));
+  auto request = fu::createRequest(fu::RestVerb::Post, "/_api/cursor");
+  fu::VBuilder builder;
+  builder.openObject();
+  builder.add("query", fu::VValue("FOR x IN 1..500 RETURN x"));
+  builder.add("batchSize", fu::VValue(500));
+  builder.close();
+  request->addVPack(builder.slice());
+  auto response = connection->sendRequest(std::move(request));
+  ASSERT_EQ(response->statusCode(), f::StatusCreated);
+  auto slice = response->slices().front();
+
+  ASSERT_TRUE(slice.isObject());
+  auto result = slice.get("result");
+  ASSERT_TRUE(result.isArray());
+  ASSERT_TRUE(result.length() == 500);
+}
+
+TEST_P(ConnectionTestF, CursorBatches){
+  auto db = _connection->getDatabase("_system");
+  auto cursor = db->createCursor("FOR x IN 1..25 RETURN x", fu::VSlice(), 10, 2);
+  std::size_t batches = 0;
+  std::size_t documents = 0;
+  while (auto batch = cursor->next()) {
+    auto result = batch->slices().front().get("result");
+    ASSERT_TRUE(result.isArray());
+    documents += result.length();
+    batches++;
+  }
+  ASSERT_EQ(batches, 3u);
+  ASSERT_EQ(documents, 25u);
+  ASSERT_TRUE(cursor->next() == nullptr);
+
+  // a cursor that is dropped early is deleted on the server
+  auto early = db->createCursor("FOR x IN 1..100 RETURN x", fu::VSlice(), 10, 1);
+  ASSERT_TRUE(early->next() != nullptr);
+  auto id = early->id();
+  ASSERT_FALSE(id.empty());
+  early.reset();
+  // the delete is sent once the batch that was fetched ahead has arrived.
+  // Probing takes a batch at most 5 times, the cursor has 8 more.
+  fu::StatusCode status = 0;
+  for (int i = 0; i < 5 && status != fu::StatusNotFound; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto request = fu::createRequest(fu::RestVerb::Put, "/_api/cursor/" + id);
+    status = _connection->sendRequest(std::move(request))->statusCode();
+  }
+  ASSERT_EQ(status, fu::StatusNotFound);
+}
+
+TEST_P(ConnectionTestF, QueryCached){
+  auto db = _connection->getDatabase("_system");
+  fu::QueryCacheOptions options;
+  options.maxBytes = 64 * 1024;
+  db->queryCaching(options);
+
+  fu::VBuilder bindVars;
+  bindVars.openObject();
+  bindVars.add("n", fu::VValue(25));
+  bindVars.close();
+  auto first = db->query("FOR x IN 1..@n RETURN x", bindVars.slice(), {"_users"});
+  ASSERT_EQ(fu::VSlice(first->data()).length(), 25u);
+  // white space does not matter, the cached buffer is shared
+  auto second = db->query("FOR x IN  1..@n\n  RETURN x", bindVars.slice(), {"_users"});
+  ASSERT_EQ(first, second);
+
+  db->invalidateQueries("_users");
+  auto third = db->query("FOR x IN 1..@n RETURN x", bindVars.slice(), {"_users"});
+  ASSERT_NE(first, third);
+  ASSERT_EQ(fu::VSlice(third->data()).length(), 25u);
+
+  // a line comment ends at the line break, what follows it counts
+  auto two = db->query("RETURN 1 // c\n + 1", fu::VSlice(), {});
+  auto one = db->query("RETURN 1 // c + 1", fu::VSlice(), {});
+  ASSERT_EQ(fu::VSlice(two->data()).at(0).getInt(), 2);
+  ASSERT_EQ(fu::VSlice(one->data()).at(0).getInt(), 1);
+  // comments do not matter otherwise
+  auto same = db->query("RETURN /* c */ 1 + 1", fu::VSlice(), {});
+  ASSERT_EQ(two, same);
+}
+
 TEST_P(ConnectionTestF, CreateDocumentSync){
   auto request = fu::createRequest(fu::RestVerb::Post, "/_api/document/_users");
   request->addVPack(fu::VSlice::emptyObjectSlice());
@@ -137,6 +389,240 @@ TEST_P(ConnectionTestF, CreateDocumentSync){
   ASSERT_TRUE(slice.get("_rev").isString());
 }
 
+TEST_P(ConnectionTestF, CreateDocumentsBatched){
+  auto collection = _connection->getDatabase("_system")->getCollection("_users");
+  fu::BatchOptions options;
+  options.maxDocuments = 4;
+  options.linger = std::chrono::milliseconds(10);
+  collection->batching(options);
+
+  f::WaitGroup wg;
+  std::atomic<int> created(0);
+  for (int i = 0; i < 10; i++) {
+    wg.add();
+    collection->insert(fu::VSlice::emptyObjectSlice(), [&](fu::Error error, fu::VSlice result) {
+      f::WaitGroupDone done(wg);
+      if (error == 0 && result.isObject() && result.get("_key").isString()) {
+        created++;
+      }
+    });
+  }
+  ASSERT_TRUE(wg.wait_for(std::chrono::seconds(10)));
+  ASSERT_EQ(created.load(), 10);
+}
+
+TEST_P(ConnectionTestF, FindDocumentsBatched){
+  auto request = fu::createRequest(fu::RestVerb::Post, "/_api/document/_users");
+  request->addVPack(fu::VSlice::emptyObjectSlice());
+  auto response = _connection->sendRequest(std::move(request));
+  ASSERT_EQ(response->statusCode(), f::StatusAccepted);
+  auto key = response->slices().front().get("_key").copyString();
+
+  auto collection = _connection->getDatabase("_system")->getCollection("_users");
+  fu::BatchOptions options;
+  options.maxDocuments = 10;
+  options.linger = std::chrono::milliseconds(10);
+  collection->lookups(options);
+
+  f::WaitGroup wg;
+  std::atomic<int> found(0);
+  std::atomic<int> missing(0);
+  for (auto const& k : {key, key, std::string("fuerte-missing-key")}) {
+    wg.add();
+    collection->find(k, [&](fu::Error error, fu::VSlice result) {
+      f::WaitGroupDone done(wg);
+      if (error != 0 || !result.isObject()) {
+        return;
+      }
+      if (result.get("_key").isString()) {
+        found++;
+      } else if (result.get("error").isTrue()) {
+        missing++;
+      }
+    });
+  }
+  ASSERT_TRUE(wg.wait_for(std::chrono::seconds(10)));
+  ASSERT_EQ(found.load(), 2);
+  ASSERT_EQ(missing.load(), 1);
+}
+
+TEST_P(ConnectionTestF, UpdateDocumentsCombined){
+  auto request = fu::createRequest(fu::RestVerb::Post, "/_api/document/_users");
+  request->addVPack(fu::VSlice::emptyObjectSlice());
+  auto response = _connection->sendRequest(std::move(request));
+  ASSERT_EQ(response->statusCode(), f::StatusAccepted);
+  auto key = response->slices().front().get("_key").copyString();
+
+  auto collection = _connection->getDatabase("_system")->getCollection("_users");
+  fu::BatchOptions options;
+  options.maxDocuments = 10;
+  options.linger = std::chrono::milliseconds(10);
+  options.combineUpdates = true;
+  collection->batching(options);
+
+  f::WaitGroup wg;
+  std::mutex mutex;
+  std::set<std::string> revisions;
+  for (int i = 0; i < 3; i++) {
+    fu::VBuilder patch;
+    patch.openObject();
+    patch.add("_key", fu::VValue(key));
+    patch.add("counter", fu::VValue(i));
+    patch.add("attr" + std::to_string(i), fu::VValue(true));
+    patch.close();
+    wg.add();
+    collection->update(patch.slice(), [&](fu::Error error, fu::VSlice result) {
+      f::WaitGroupDone done(wg);
+      if (error == 0 && result.isObject() && result.get("_rev").isString()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        revisions.insert(result.get("_rev").copyString());
+      }
+    });
+  }
+  ASSERT_TRUE(wg.wait_for(std::chrono::seconds(10)));
+  // one write for all three updates
+  ASSERT_EQ(revisions.size(), 1);
+
+  response = _connection->sendRequest(fu::createRequest(fu::RestVerb::Get, "/_api/document/_users/" + key));
+  ASSERT_EQ(response->statusCode(), f::StatusOK);
+  auto document = response->slices().front();
+  ASSERT_EQ(document.get("counter").getInt(), 2);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(document.get("attr" + std::to_string(i)).isTrue());
+  }
+}
+
+TEST_P(ConnectionTestF, FindDocumentsCached){
+  auto collection = _connection->getDatabase("_system")->getCollection("_users");
+  fu::CacheOptions options;
+  options.maxBytes = 64 * 1024;
+  collection->caching(options);
+
+  fu::VBuilder document;
+  document.openObject();
+  document.add("counter", fu::VValue(42));
+  document.close();
+  f::WaitGroup wg;
+  std::string key;
+  wg.add();
+  collection->insert(document.slice(), [&](fu::Error error, fu::VSlice result) {
+    f::WaitGroupDone done(wg);
+    if (error == 0 && result.isObject() && result.get("_key").isString()) {
+      key = result.get("_key").copyString();
+    }
+  });
+  ASSERT_TRUE(wg.wait_for(std::chrono::seconds(10)));
+  ASSERT_FALSE(key.empty());
+
+  // the inserted document is answered from the cache
+  bool cached = false;
+  collection->find(key, [&](fu::Error error, fu::VSlice result) {
+    cached = error == 0 && result.get("_key").copyString() == key &&
+             result.get("_rev").isString() && result.get("counter").getInt() == 42;
+  });
+  ASSERT_TRUE(cached);
+
+  // dropped documents are fetched again
+  fu::VBuilder dropKey;
+  dropKey.add(fu::VValue(key));
+  wg.add();
+  collection->drop(dropKey.slice(), [&](fu::Error, fu::VSlice) { f::WaitGroupDone done(wg); });
+  ASSERT_TRUE(wg.wait_for(std::chrono::seconds(10)));
+  bool missing = false;
+  wg.add();
+  collection->find(key, [&](fu::Error error, fu::VSlice result) {
+    f::WaitGroupDone done(wg);
+    missing = error == 0 && result.isObject() && result.get("error").isTrue();
+  });
+  ASSERT_TRUE(wg.wait_for(std::chrono::seconds(10)));
+  ASSERT_TRUE(missing);
+}
+
+TEST_P(ConnectionTestF, TransactionCommit){
+  fu::TransactionOptions options;
+  options.write.push_back("_users");
+  auto trx = _connection->getDatabase("_system")->beginTransaction(options);
+
+  f::WaitGroup wg;
+  std::atomic<int> created(0);
+  for (int i = 0; i < 20; i++) {
+    wg.add();
+    trx->insert("_users", fu::VSlice::emptyObjectSlice(), [&](fu::Error error, fu::VSlice result) {
+      f::WaitGroupDone done(wg);
+      if (error == 0 && result.isObject() && result.get("_key").isString()) {
+        created++;
+      }
+    });
+  }
+  bool committed = false;
+  wg.add();
+  trx->commit([&](fu::Error error, fu::VSlice result) {
+    f::WaitGroupDone done(wg);
+    committed = error == 0 && result.isObject() &&
+                result.get("result").get("status").copyString() == "committed";
+  });
+  ASSERT_TRUE(wg.wait_for(std::chrono::seconds(10)));
+  ASSERT_EQ(created.load(), 20);
+  ASSERT_TRUE(committed);
+  ASSERT_FALSE(trx->id().empty());
+}
+
+TEST_P(ConnectionTestF, BatchRequests){
+  if (std::string(GetParam()._url).compare(0, 4, "http") != 0) {
+    return; // /_api/batch is an HTTP API
+  }
+  auto batch = _connection->getDatabase("_system")->createBatch();
+  f::WaitGroup wg;
+  std::atomic<int> versions(0);
+  std::atomic<int> created(0);
+  for (int i = 0; i < 3; i++) {
+    wg.add();
+    batch->add(fu::createRequest(fu::RestVerb::Get, "/_api/version"),
+        [&](fu::Error error, std::unique_ptr<fu::Request>, std::unique_ptr<fu::Response> res) {
+      f::WaitGroupDone done(wg);
+      if (error == 0 && res->statusCode() == f::StatusOK &&
+          res->slices().front().get("server").copyString() == "arango") {
+        versions++;
+      }
+    });
+  }
+  wg.add();
+  batch->add(fu::createRequest(fu::RestVerb::Post, "/_api/document/_users", fu::StringMap(),
+                               fu::VSlice::emptyObjectSlice()),
+      [&](fu::Error error, std::unique_ptr<fu::Request>, std::unique_ptr<fu::Response> res) {
+    f::WaitGroupDone done(wg);
+    if (error == 0 && res->statusCode() == f::StatusAccepted &&
+        res->slices().front().get("_key").isString()) {
+      created++;
+    }
+  });
+  ASSERT_EQ(batch->size(), 4u);
+  batch->send();
+  ASSERT_EQ(batch->size(), 0u);
+  ASSERT_TRUE(wg.wait_for(std::chrono::seconds(10)));
+  ASSERT_EQ(versions.load(), 3);
+  ASSERT_EQ(created.load(), 1);
+}
+
+TEST_P(ConnectionTestF, ImportDocuments){
+  auto collection = _connection->getDatabase("_system")->getCollection("_users");
+  fu::ImportOptions options;
+  options.batchBytes = 256;
+  options.maxInFlight = 2;
+  auto importer = collection->importer(options);
+
+  std::stringstream lines;
+  for (int i = 0; i < 50; i++) {
+    importer->add(fu::VSlice::emptyObjectSlice());
+    lines << "{}" << std::endl;
+  }
+  importer->addJsonLines(lines);
+  auto result = importer->finish();
+  ASSERT_EQ(result.failed, 0u);
+  ASSERT_EQ(result.errors, 0u);
+  ASSERT_EQ(result.created, 100u);
+}
+
 TEST_P(ConnectionTestF, ShortAndLongASync){
   f::WaitGroup wg;
   fu::RequestCallback cb = [&](fu::Error error, std::unique_ptr<fu::Request> req, std::unique_ptr<fu::Response> res) {
@@ -184,6 +670,11 @@ const ConnectionTestParams connectionTestParams[] = {
   {._url= "vst://127.0.0.1:8529", ._threads=4, ._repeat=100},
   {._url= "http://localhost:8529", ._threads=1, ._repeat=10},
   {._url= "vst://localhost:8529", ._threads=1, ._repeat=10},
+  {._url= "http://127.0.0.1:8529", ._threads=1, ._repeat=10, ._httpBackend=f::http::AsioBackend},
+  {._url= "http://127.0.0.1:8529", ._threads=4, ._repeat=100, ._httpBackend=f::http::AsioBackend},
+  {._url= "http://127.0.0.1:8529", ._threads=4, ._repeat=100, ._httpBackend=f::http::AsioBackend, ._httpPipelining=true},
+  {._url= "vst://127.0.0.1:8529", ._threads=4, ._repeat=100, ._vstValidation=f::vst::ValidateFull},
+  {._url= "vst://127.0.0.1:8529", ._threads=4, ._repeat=100, ._vstValidation=f::vst::ValidateNone},
 };
 
 INSTANTIATE_TEST_CASE_P(BasicConnectionTests, ConnectionTestF,
@@ -21,7 +21,64 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "test_main.h"
 
+#include <fuerte/requests.h>
+
+#include "../src/vst.h"
+
+namespace fu = ::arangodb::fuerte;
+
 
 TEST(VSTBasic, PackUnpack){
   ASSERT_TRUE(true); //TODO -- DELETE
 }
+
+TEST(VSTBasic, StreamChunksOutOfOrder){
+  // message header [version, type, responseCode, meta] followed by the body
+  fu::VBuilder header;
+  header.openArray();
+  header.add(fu::VValue(1));
+  header.add(fu::VValue(2));
+  header.add(fu::VValue(200));
+  header.openObject();
+  header.close();
+  header.close();
+  std::string message(reinterpret_cast<char const*>(header.slice().start()), header.slice().byteSize());
+  std::string body = "0123456789abcdefghij";
+  message.append(body);
+
+  std::string received;
+  auto request = fu::createRequest(fu::RestVerb::Get, "/_api/version");
+  request->streamResponse([&received](fu::StatusCode, uint8_t const* data, std::size_t length) {
+    received.append(reinterpret_cast<char const*>(data), length);
+  });
+  auto item = std::make_shared<fu::vst::RequestItem>();
+  item->_request = std::move(request);
+  // chunks that arrive early must not spill, more of them follow
+  item->_responseChunkContent.configure(1, std::string());
+
+  // the header is in chunk 0, the body is split over chunks 1..4
+  uint32_t const numberOfChunks = 5;
+  std::vector<std::string> parts;
+  parts.push_back(message.substr(0, header.slice().byteSize()));
+  for (std::size_t i = 0; i < 4; i++) {
+    parts.push_back(body.substr(i * 5, 5));
+  }
+  auto chunk = [&](uint32_t index) {
+    fu::vst::ChunkHeader c;
+    c._chunkX = index == 0 ? ((numberOfChunks << 1) | 1) : (index << 1);
+    c._messageID = 1;
+    c._messageLength = message.size();
+    c._data = boost::asio::const_buffer(parts[index].data(), parts[index].size());
+    c._chunkLength = static_cast<uint32_t>(parts[index].size());
+    return c;
+  };
+
+  // 1 & 3 wait, 0 passes 0 & 1 on, 4 waits behind 3, 2 completes the message
+  for (uint32_t index : {1u, 3u, 0u, 4u}) {
+    auto c = chunk(index);
+    ASSERT_FALSE(item->streamChunk(c));
+  }
+  auto last = chunk(2);
+  ASSERT_TRUE(item->streamChunk(last));
+  ASSERT_EQ(received, body);
+}